@@ -50,7 +50,7 @@ FisheyeCamera::FisheyeCamera(const Point _Eye, const Point _At, const Vector _Up
     max_radius = 1.0f;
 }
 
-bool FisheyeCamera::GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter) {
+bool FisheyeCamera::GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter, const float * /*lens*/) {
     float pixel_x, pixel_y;
     
     // Calculate pixel coordinates with or without jittering
@@ -40,7 +40,7 @@ public:
                  const bool _is_radians,
                  const ProjectionType _projection = STEREOGRAPHIC);
     
-    bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL) override;
+    bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL, const float *lens=NULL) override;
     void getResolution(int *_W, int *_H) override {*_W=W; *_H=H;}
     
     // Utility methods
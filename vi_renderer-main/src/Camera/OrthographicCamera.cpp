@@ -63,7 +63,7 @@ OrthographicCamera::OrthographicCamera(const Point _Eye, const Point _At, const
     viewport_topleft = Eye + left * right + top * Up;
 }
 
-bool OrthographicCamera::GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter) {
+bool OrthographicCamera::GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter, const float * /*lens*/) {
     Point pixel_coord;
     
     // Calculate pixel coordinates with or without jittering
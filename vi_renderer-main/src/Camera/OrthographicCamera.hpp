@@ -31,7 +31,7 @@ public:
     OrthographicCamera(const Point _Eye, const Point _At, const Vector _Up, 
                       const int _W, const int _H, const float _width);
     
-    bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL) override;
+    bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL, const float *lens=NULL) override;
     void getResolution(int *_W, int *_H) override {*_W=W; *_H=H;}
     
     // Utility methods
@@ -15,7 +15,9 @@ class Camera {
 public:
     Camera () {}
     ~Camera() {}
-    virtual bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL) {return false;};
+    // cam_jitter: position within the pixel, lens: position on the lens (both 2 floats in [0,1[)
+    // NULL means the pixel centre / the lens centre
+    virtual bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL, const float * /*lens*/=NULL) {return false;};
     virtual void getResolution (int *_W, int *_H) {*_W=0; *_H=0;}
 };
 
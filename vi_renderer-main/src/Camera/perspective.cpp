@@ -8,7 +8,7 @@
 
 #include "Perspective.hpp"
 
-bool Perspective::GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter) {
+bool Perspective::GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter, const float *lens) {
     Point pc;
     
     if (cam_jitter==NULL) {
@@ -22,8 +22,8 @@ bool Perspective::GenerateRay(const int x, const int y, Ray *r, const float *cam
     
     Point pixel_sample = pixel00_loc + (pc.X * pixel_delta_u) + (pc.Y * pixel_delta_v);
     r->o = Eye;
-    if (defocus_angle > 0.f) {
-        Point p = random_in_unit_disk();
+    if (defocus_angle > 0.f && lens != NULL) {
+        Point p = concentric_disk(lens);
         r->o = Eye + p.X * defocus_disk_R + p.Y*defocus_disk_Up;
     } else {
         r->o = Eye;
@@ -12,7 +12,7 @@
 #include "camera.hpp"
 #include "ray.hpp"
 #include "vector.hpp"
-#include <random>
+#include <math.h>
 
 class Perspective: public Camera {
 private:
@@ -22,19 +22,20 @@ private:
     int W, H;
     float defocus_angle;
 
-    /****************************************
-     
-     Our Random Number Generator (rng) */
-    std::random_device rdev{};
-    std::mt19937 rng{rdev()};
-    std::uniform_real_distribution<float>U_dist{-1.0,1.0};  // uniform distribution in[0,1[
-    
-    inline Point random_in_unit_disk() {
-        while (true) {
-            Point p(U_dist(rng), U_dist(rng), 0.);
-            if ((p.X*p.X + p.Y*p.Y) < 1.)
-                return p;
+    // maps a point of [0,1[^2 to the unit disk, preserving stratification
+    // (Shirley and Chiu's concentric mapping)
+    static Point concentric_disk(const float *u) {
+        float const ox = 2.f * u[0] - 1.f, oy = 2.f * u[1] - 1.f;
+        if (ox == 0.f && oy == 0.f) return Point(0., 0., 0.);
+        float r, theta;
+        if (fabsf(ox) > fabsf(oy)) {
+            r = ox;
+            theta = 0.78539816f * (oy / ox);
+        } else {
+            r = oy;
+            theta = 1.57079633f - 0.78539816f * (ox / oy);
         }
+        return Point(r * cosf(theta), r * sinf(theta), 0.);
     }
     
     Point Eye, At;         // Camera center
@@ -80,7 +81,7 @@ public:
         defocus_disk_Up = Up * defocus_radius;
     }
 
-    bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL);
+    bool GenerateRay(const int x, const int y, Ray *r, const float *cam_jitter=NULL, const float *lens=NULL);
     void getResolution (int *_W, int *_H) {*_W=W; *_H=H;}
 };
 
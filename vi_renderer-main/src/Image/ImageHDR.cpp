@@ -0,0 +1,191 @@
+//
+//  ImageHDR.cpp
+//  VI-RT
+//
+//  RGBE conversion and run length encoding as in Greg Ward's Radiance
+//  (and Bruce Walter's rgbe.c)
+//
+
+#include "ImageHDR.hpp"
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+
+// run length encoding is only defined for these scanline widths
+#define RLE_MIN_WIDTH 8
+#define RLE_MAX_WIDTH 0x7fff
+// shortest run worth encoding
+#define RLE_MIN_RUN 4
+
+static void ToRGBE (RGB const& c, unsigned char *rgbe) {
+    float const v = std::max(c.R, std::max(c.G, c.B));
+    if (v < 1e-32f) {
+        rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+        return;
+    }
+    int e;
+    float const m = frexpf(v, &e) * 256.f / v;
+    rgbe[0] = (unsigned char)(std::max(c.R, 0.f) * m);
+    rgbe[1] = (unsigned char)(std::max(c.G, 0.f) * m);
+    rgbe[2] = (unsigned char)(std::max(c.B, 0.f) * m);
+    rgbe[3] = (unsigned char)(e + 128);
+}
+
+static RGB FromRGBE (unsigned char const *rgbe) {
+    if (rgbe[3] == 0) return RGB(0., 0., 0.);
+    float const f = ldexpf(1.f, (int)rgbe[3] - (128 + 8));
+    return RGB((rgbe[0] + 0.5f) * f, (rgbe[1] + 0.5f) * f, (rgbe[2] + 0.5f) * f);
+}
+
+// one component (stride 4 apart) of a scanline of n RGBE pixels
+static void EncodeRuns (unsigned char const *data, int const n, std::vector<unsigned char>& out) {
+    int cur = 0;
+    while (cur < n) {
+        // the next run of at least RLE_MIN_RUN equal bytes
+        int beg_run = cur, run_count = 0, old_run_count = 0;
+        while (run_count < RLE_MIN_RUN && beg_run < n) {
+            beg_run += run_count;
+            old_run_count = run_count;
+            run_count = 1;
+            while (beg_run + run_count < n && run_count < 127 &&
+                   data[4*beg_run] == data[4*(beg_run + run_count)]) run_count++;
+        }
+        // a short run just before the long one
+        if (old_run_count > 1 && old_run_count == beg_run - cur) {
+            out.push_back((unsigned char)(128 + old_run_count));
+            out.push_back(data[4*cur]);
+            cur = beg_run;
+        }
+        // bytes up to the run, as literals
+        while (cur < beg_run) {
+            int const nonrun = std::min(128, beg_run - cur);
+            out.push_back((unsigned char)nonrun);
+            for (int i = 0 ; i < nonrun ; i++) out.push_back(data[4*(cur + i)]);
+            cur += nonrun;
+        }
+        if (run_count >= RLE_MIN_RUN) {
+            out.push_back((unsigned char)(128 + run_count));
+            out.push_back(data[4*beg_run]);
+            cur += run_count;
+        }
+    }
+}
+
+ImageHDR::ImageHDR (Image const& img): Image(img.W, img.H) {
+    memcpy((void *)imagePlane, (void const *)img.Pixels(), W*H*sizeof(RGB));
+}
+
+bool ImageHDR::Save (std::string filename) {
+    if (W == 0 || H == 0) { fprintf(stderr, "Can't save an empty image\n"); return false; }
+
+    // the whole file is built in memory and written at once
+    std::string const header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(H) + " +X " + std::to_string(W) + "\n";
+    std::vector<unsigned char> out(header.begin(), header.end());
+    out.reserve(header.size() + (size_t)W * H * 4);
+
+    bool const rle = (W >= RLE_MIN_WIDTH && W <= RLE_MAX_WIDTH);
+    std::vector<unsigned char> scanline(W * 4);
+    for (int y = 0 ; y < H ; y++) {
+        for (int x = 0 ; x < W ; x++) ToRGBE(imagePlane[y*W+x], &scanline[4*x]);
+        if (!rle) {
+            out.insert(out.end(), scanline.begin(), scanline.end());
+            continue;
+        }
+        // scanline header, then each component encoded separately
+        out.push_back(2);
+        out.push_back(2);
+        out.push_back((unsigned char)(W >> 8));
+        out.push_back((unsigned char)(W & 0xff));
+        for (int c = 0 ; c < 4 ; c++) EncodeRuns(&scanline[c], W, out);
+    }
+
+    std::ofstream ofs;
+    try {
+        ofs.open(filename, std::ios::binary);
+        if (ofs.fail()) throw("Can't open output file");
+        ofs.write(reinterpret_cast<char const *>(out.data()), (std::streamsize)out.size());
+        ofs.close();
+        if (ofs.fail()) throw("Can't write output file");
+        return true;
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s\n", err);
+        ofs.close();
+        return false;
+    }
+}
+
+bool ImageHDR::Load (std::string filename) {
+    std::ifstream ifs;
+    ifs.open(filename, std::ios::binary);
+    try {
+        if (ifs.fail()) throw("Can't open input file");
+        std::string line;
+        std::getline(ifs, line);
+        if (line.compare(0, 2, "#?") != 0) throw("Can't read input file");
+        // header lines, up to an empty one
+        while (std::getline(ifs, line) && !line.empty()) {
+            if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") throw("Unsupported HDR format");
+        }
+        // resolution: only the standard orientation (rows from the top, pixels from the left)
+        int w = 0, h = 0;
+        std::getline(ifs, line);
+        if (sscanf(line.c_str(), "-Y %d +X %d", &h, &w) != 2 || w <= 0 || h <= 0) throw("Unsupported HDR resolution");
+
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        ifs.close();
+
+        std::vector<unsigned char> scanline(w * 4);
+        std::vector<RGB> pixels((size_t)w * h);
+        size_t pos = 0;
+        for (int y = 0 ; y < h ; y++) {
+            bool const rle = (w >= RLE_MIN_WIDTH && w <= RLE_MAX_WIDTH && pos + 4 <= data.size() &&
+                              data[pos] == 2 && data[pos+1] == 2 && !(data[pos+2] & 0x80));
+            if (!rle) {
+                // flat scanline
+                if (pos + (size_t)w * 4 > data.size()) throw("Truncated input file");
+                std::copy(data.begin() + pos, data.begin() + pos + w * 4, scanline.begin());
+                pos += w * 4;
+            }
+            else {
+                if (((data[pos+2] << 8) | data[pos+3]) != w) throw("Wrong HDR scanline width");
+                pos += 4;
+                for (int c = 0 ; c < 4 ; c++) {
+                    int x = 0;
+                    while (x < w) {
+                        if (pos >= data.size()) throw("Truncated input file");
+                        int count = data[pos++];
+                        if (count > 128) {
+                            // run
+                            count -= 128;
+                            if (count > w - x || pos >= data.size()) throw("Bad HDR run length data");
+                            unsigned char const v = data[pos++];
+                            for (int i = 0 ; i < count ; i++) scanline[4*(x++) + c] = v;
+                        }
+                        else {
+                            // literals
+                            if (count == 0 || count > w - x || pos + count > data.size()) throw("Bad HDR run length data");
+                            for (int i = 0 ; i < count ; i++) scanline[4*(x++) + c] = data[pos++];
+                        }
+                    }
+                }
+            }
+            for (int x = 0 ; x < w ; x++) pixels[(size_t)y*w + x] = FromRGBE(&scanline[4*x]);
+        }
+
+        if (imagePlane != NULL) delete[] imagePlane;
+        W = w;
+        H = h;
+        imagePlane = new RGB[W*H];
+        std::copy(pixels.begin(), pixels.end(), imagePlane);
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s\n", err);
+        ifs.close();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+//
+//  ImageHDR.hpp
+//  VI-RT
+//
+//  Radiance .hdr (RGBE) images: each pixel is 3 8 bit mantissas sharing an
+//  8 bit exponent, 4 bytes per pixel for the whole HDR range (~1% precision).
+//  Scanlines are saved run length encoded (as written by Radiance), except
+//  for widths the encoding does not support; both kinds are loaded.
+//
+
+#ifndef ImageHDR_hpp
+#define ImageHDR_hpp
+#include "image.hpp"
+
+class ImageHDR: public Image {
+public:
+    ImageHDR(const int W, const int H):Image(W, H) {}
+    ImageHDR():Image() {}
+    // a copy of img's pixels (e.g., to save a rendered ImagePPM as HDR)
+    ImageHDR(Image const& img);
+    bool Save (std::string filename);
+    bool Load (std::string filename);
+};
+
+#endif /* ImageHDR_hpp */
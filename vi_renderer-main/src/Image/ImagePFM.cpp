@@ -0,0 +1,96 @@
+//
+//  ImagePFM.cpp
+//  VI-RT
+//
+
+#include "ImagePFM.hpp"
+#include "MappedFile.hpp"
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+
+static bool LittleEndian () {
+    uint16_t const one = 1;
+    return *(uint8_t const *)&one == 1;
+}
+
+ImagePFM::ImagePFM (Image const& img): Image(img.W, img.H) {
+    memcpy((void *)imagePlane, (void const *)img.Pixels(), W*H*sizeof(RGB));
+}
+
+bool ImagePFM::Save (std::string filename) {
+    if (W == 0 || H == 0) { fprintf(stderr, "Can't save an empty image\n"); return false; }
+
+    std::ofstream ofs;
+    try {
+        ofs.open(filename, std::ios::binary);
+        if (ofs.fail()) throw("Can't open output file");
+        // the scale's sign gives the floats' byte order: written as in memory
+        ofs << "PF\n" << W << " " << H << "\n" << (LittleEndian() ? "-1.0" : "1.0") << "\n";
+        // imagePlane rows, bottom row first
+        for (int y = H-1 ; y >= 0 ; y--) {
+            ofs.write(reinterpret_cast<char const *>(&imagePlane[y*W]), (std::streamsize)W * sizeof(RGB));
+        }
+        ofs.close();
+        if (ofs.fail()) throw("Can't write output file");
+        return true;
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s\n", err);
+        ofs.close();
+        return false;
+    }
+}
+
+bool ImagePFM::Load (std::string filename) {
+    MappedFile f;
+    try {
+        if (!f.Open(filename)) throw("Can't open input file");
+        std::string magic, scale;
+        int w, h;
+        size_t offset;
+        // PF : RGB ; Pf : grayscale
+        if (!ParsePNMHeader(f, &magic, &w, &h, &scale, &offset) || (magic != "PF" && magic != "Pf")) throw("Can't read input file");
+        bool const color = (magic == "PF");
+        int const channels = color ? 3 : 1;
+        size_t const n = (size_t)w * h * channels;
+        if (f.Size() - offset < n * sizeof(float)) throw("Truncated input file");
+        // swap the bytes if the file's byte order (scale < 0 : little endian) is not the machine's
+        bool const swap = ((atof(scale.c_str()) < 0.) != LittleEndian());
+
+        if (imagePlane != NULL) delete[] imagePlane;
+        W = w;
+        H = h;
+        imagePlane = new RGB[W*H];
+        unsigned char const* data = f.Data() + offset;
+        // rows are stored bottom row first
+        for (int y = 0 ; y < H ; y++) {
+            float *out = reinterpret_cast<float *>(&imagePlane[y*W]);
+            unsigned char const* row = data + (size_t)(H-1-y) * W * channels * sizeof(float);
+            if (color && !swap) {
+                memcpy(out, row, (size_t)W * sizeof(RGB));
+                continue;
+            }
+            for (int i = 0 ; i < W * channels ; i++) {
+                unsigned char b[4];
+                memcpy(b, row + i * sizeof(float), sizeof(float));
+                if (swap) {
+                    std::swap(b[0], b[3]);
+                    std::swap(b[1], b[2]);
+                }
+                float v;
+                memcpy(&v, b, sizeof(float));
+                if (color) out[i] = v;
+                else out[3*i] = out[3*i+1] = out[3*i+2] = v;
+            }
+        }
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s\n", err);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+//
+//  ImagePFM.hpp
+//  VI-RT
+//
+//  Portable Float Map: the image's radiance as 32 bit floats, without clamping
+//  nor tone mapping (HDR), so that it can be tone mapped later without re-rendering.
+//  Header "PF\nW H\n<scale>\n" (scale < 0 : little endian) followed by the rows,
+//  from the bottom, of R,G,B floats.
+//
+
+#ifndef ImagePFM_hpp
+#define ImagePFM_hpp
+#include "image.hpp"
+
+class ImagePFM: public Image {
+public:
+    ImagePFM(const int W, const int H):Image(W, H) {}
+    ImagePFM():Image() {}
+    // a copy of img's pixels (e.g., to save a rendered ImagePPM as HDR)
+    ImagePFM(Image const& img);
+    bool Save (std::string filename);
+    bool Load (std::string filename);
+};
+
+#endif /* ImagePFM_hpp */
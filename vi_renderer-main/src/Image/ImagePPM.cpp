@@ -6,62 +6,37 @@
 //
 
 #include "ImagePPM.hpp"
+#include "MappedFile.hpp"
+#include "ToneMapper.hpp"
+#include "PostProcess.hpp"
 #include <iostream>
 #include <fstream>
-#include "Box.hpp"
-#include "Median.hpp"
+#include <vector>
+#include <cmath>
+#include <cstdlib>
 
-void ImagePPM::ImgClamp (int const W, int const H, RGB *image, char_pixel *img2save, bool apply_tone_mapping) {
-    
-    RGB * imageTM = new RGB[W*H];
-    
-    if (apply_tone_mapping) {
-        Median F;
-        for (int i = 0; i < W * H; i++) {
-            imageTM[i] = image[i];
-        }
-    } else {
-        // Sem tone mapping - apenas copia
-        for (int i = 0; i < W * H; i++) {
-            imageTM[i] = image[i];
-        }
-    }
-    
+static_assert(sizeof(char_pixel) == 3, "char_pixel must be the 3 bytes of a binary PPM pixel");
+
+void ImagePPM::ImgClamp (int const W, int const H, RGB *image, char_pixel *img2save) {
     // loop over each pixel in the image, clamp and convert to byte format
-    for (int j = 0 ; j< H ; j++) {
-        for (int i = 0; i < W ; ++i) {
-            RGB Cout = imageTM[j*W+i];
-            img2save[j*W+i].val[0] = (unsigned char)(fmax(fmin(1.f, Cout.R),0.f) * 255);
-            img2save[j*W+i].val[1] = (unsigned char)(fmax(fmin(1.f, Cout.G),0.f) * 255);
-            img2save[j*W+i].val[2] = (unsigned char)(fmax(fmin(1.f, Cout.B),0.f) * 255);
-        }
+    for (int i = 0; i < W * H; i++) {
+        RGB const& Cout = image[i];
+        img2save[i].val[0] = (unsigned char)(fmax(fmin(1.f, Cout.R),0.f) * 255);
+        img2save[i].val[1] = (unsigned char)(fmax(fmin(1.f, Cout.G),0.f) * 255);
+        img2save[i].val[2] = (unsigned char)(fmax(fmin(1.f, Cout.B),0.f) * 255);
     }
-    delete [] imageTM;
 }
 
-bool ImagePPM::Save (std::string filename) {
-    if (W == 0 || H == 0) { fprintf(stderr, "Can't save an empty image\n"); return false; }
-    
-    // convert from float to {0,1,..., 255}
-    imageToSave = new char_pixel[W*H];
-
-    // O tone mapping já foi aplicado no main.cpp
-    ImgClamp(W, H, imagePlane, imageToSave, false);  // false = sem tone mapping
-    
+bool ImagePPM::Write (std::string filename, char_pixel const* pixels) {
     std::ofstream ofs;
     try {
         ofs.open(filename, std::ios::binary);  //need to spec. binary mode for Windows users
         if (ofs.fail()) throw("Can't open output file");
         ofs << "P6\n" << W << " " << H << "\n255\n";
-        unsigned char r, g, b;
-        // loop over each pixel in the image, clamp and convert to byte format
-        for (int i = 0; i < W * H; ++i) {
-            r = imageToSave[i].val[0];
-            g = imageToSave[i].val[1];
-            b = imageToSave[i].val[2];
-            ofs << r << g << b;
-        }
+        // all pixels in a single write
+        ofs.write(reinterpret_cast<char const *>(pixels), (std::streamsize)W * H * sizeof(char_pixel));
         ofs.close();
+        if (ofs.fail()) throw("Can't write output file");
         return true;
     }
     catch (const char *err) {
@@ -71,39 +46,69 @@ bool ImagePPM::Save (std::string filename) {
     }
 }
 
+bool ImagePPM::Save (std::string filename) {
+    if (W == 0 || H == 0) { fprintf(stderr, "Can't save an empty image\n"); return false; }
+    
+    // convert from float to {0,1,..., 255}, straight into the output buffer
+    // (char_pixel is 3 bytes, so the buffer is the PPM's binary data)
+    std::vector<char_pixel> imageToSave(W*H);
+    ImgClamp(W, H, imagePlane, imageToSave.data());
+    
+    return Write(filename, imageToSave.data());
+}
+
+bool ImagePPM::Save (std::string filename, ToneMapper const& tm, RGB *hdrMin, RGB *hdrMax) {
+    if (W == 0 || H == 0) { fprintf(stderr, "Can't save an empty image\n"); return false; }
+    
+    std::vector<char_pixel> imageToSave(W*H);
+    tm.ToneMap8(W, H, imagePlane, imageToSave.data(), 0, hdrMin, hdrMax);
+    
+    return Write(filename, imageToSave.data());
+}
+
+bool ImagePPM::Save (std::string filename, PostProcess& pp, RGB *hdrMin, RGB *hdrMax) {
+    if (W == 0 || H == 0) { fprintf(stderr, "Can't save an empty image\n"); return false; }
+    
+    std::vector<char_pixel> imageToSave(W*H);
+    pp.Apply8(W, H, imagePlane, imageToSave.data(), hdrMin, hdrMax);
+    
+    return Write(filename, imageToSave.data());
+}
+
 bool ImagePPM::Load (std::string filename) {
-    std::ifstream ifs;
-     ifs.open(filename, std::ios::binary);
-     // need to spec. binary mode for Windows users
-     //Image src;
-     try {
-         if (ifs.fail()) {
-             throw("Can't open input file");
-             return false;
-         }
-         std::string header;
-         int w, h, b;
-         ifs >> header;
-         if (strcmp(header.c_str(), "P6") != 0) throw("Can't read input file");
-         ifs >> w >> h >> b;
-         W = w;
-         H = h;
-         imagePlane =  new RGB[W*H];
-         ifs.ignore(256, '\n');  //skip empty lines in necessary until we get to the binary data
-         unsigned char pix[3];  //read each pixel one by one and convert bytes to floats
-         for (int i = 0; i < w * h; ++i) {
-             ifs.read(reinterpret_cast<char *>(pix), 3);
-             imagePlane[i].R = pix[0] / 255.f;
-             imagePlane[i].G = pix[1] / 255.f;
-             imagePlane[i].B = pix[2] / 255.f;
-         }
-         ifs.close();
-     }
-     catch (const char *err) {
-         fprintf(stderr, "%s\n", err);
-         ifs.close();
-         return false;
-     }
-  
-     return true;
-}
\ No newline at end of file
+    MappedFile f;
+    try {
+        if (!f.Open(filename)) throw("Can't open input file");
+        std::string magic, maxval;
+        int w, h;
+        size_t offset;
+        if (!ParsePNMHeader(f, &magic, &w, &h, &maxval, &offset) || magic != "P6") throw("Can't read input file");
+        int const maxv = atoi(maxval.c_str());
+        if (maxv <= 0 || maxv > 65535) throw("Can't read input file");
+        // 1 byte per component, 2 (big endian) if maxval > 255
+        size_t const bytes = (maxv < 256) ? 1 : 2;
+        size_t const n = (size_t)w * h * 3;
+        if (f.Size() - offset < n * bytes) throw("Truncated input file");
+
+        if (imagePlane != NULL) delete[] imagePlane;   // a previously loaded image
+        W = w;
+        H = h;
+        imagePlane = new RGB[W*H];
+        // the components straight from the mapped file to the floats of imagePlane,
+        // in a single loop the compiler vectorizes
+        float *out = reinterpret_cast<float *>(imagePlane);
+        unsigned char const* in = f.Data() + offset;
+        float const scale = (float)maxv;
+        if (bytes == 1) {
+            for (size_t i = 0 ; i < n ; i++) out[i] = in[i] / scale;
+        }
+        else {
+            for (size_t i = 0 ; i < n ; i++) out[i] = ((in[2*i] << 8) | in[2*i+1]) / scale;
+        }
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s\n", err);
+        return false;
+    }
+    return true;
+}
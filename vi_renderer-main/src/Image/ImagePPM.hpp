@@ -9,16 +9,26 @@
 #define ImagePPM_hpp
 #include "image.hpp"
 
-class ImagePPM: public Image {
-    char_pixel *imageToSave;
+class ToneMapper;
+class PostProcess;
 
+class ImagePPM: public Image {
+    // the header and the 8 bit pixels, in a single write
+    bool Write (std::string filename, char_pixel const* pixels);
 public:
     ImagePPM(const int W, const int H):Image(W, H) {}
     ImagePPM():Image() {}
     bool Save (std::string filename);
+    // tone mapped and quantized by tm in a single pass (imagePlane is not modified);
+    // hdrMin, hdrMax (optional): the HDR range, found in the same pass
+    bool Save (std::string filename, ToneMapper const& tm, RGB *hdrMin = NULL, RGB *hdrMax = NULL);
+    // through the post-processing pipeline pp (imagePlane is not modified)
+    bool Save (std::string filename, PostProcess& pp, RGB *hdrMin = NULL, RGB *hdrMax = NULL);
+    // binary PPM (P6, maxval up to 65535) read from the memory mapped file;
+    // replaces the image's previous contents
     bool Load (std::string filename);
-    
-    void ImgClamp (int const W, int const H, RGB *image, char_pixel *img2save, bool apply_tone_mapping = false);
+    // clamped to [0,1] and quantized, without tone mapping
+    void ImgClamp (int const W, int const H, RGB *image, char_pixel *img2save);
 };
 
 #endif /* ImagePPM_hpp */
\ No newline at end of file
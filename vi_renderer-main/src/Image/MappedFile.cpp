@@ -0,0 +1,64 @@
+//
+//  MappedFile.cpp
+//  VI-RT
+//
+
+#include "MappedFile.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstdlib>
+
+bool MappedFile::Open (std::string filename) {
+    Close();
+    int const fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void *const a = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file
+    if (a == MAP_FAILED) return false;
+    // read sequentially when loading
+    madvise(a, (size_t)st.st_size, MADV_SEQUENTIAL);
+    addr = a;
+    length = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close () {
+    if (addr != NULL) munmap(addr, length);
+    addr = NULL;
+    length = 0;
+}
+
+bool ParsePNMHeader (MappedFile const& f, std::string *magic, int *W, int *H, std::string *maxval, size_t *offset) {
+    unsigned char const* d = f.Data();
+    size_t const n = f.Size();
+    size_t pos = 0;
+    std::string tokens[4];
+
+    for (int t = 0 ; t < 4 ; t++) {
+        // skip whitespace and comments
+        while (pos < n && (isspace(d[pos]) || d[pos] == '#')) {
+            if (d[pos] == '#') while (pos < n && d[pos] != '\n') pos++;
+            else pos++;
+        }
+        while (pos < n && !isspace(d[pos]) && d[pos] != '#') tokens[t] += (char)d[pos++];
+        if (tokens[t].empty()) return false;
+    }
+    // a single whitespace separates the header from the binary data
+    if (pos >= n || !isspace(d[pos])) return false;
+    pos++;
+
+    *magic = tokens[0];
+    *W = atoi(tokens[1].c_str());
+    *H = atoi(tokens[2].c_str());
+    *maxval = tokens[3];
+    *offset = pos;
+    return (*W > 0 && *H > 0);
+}
@@ -0,0 +1,40 @@
+//
+//  MappedFile.hpp
+//  VI-RT
+//
+//  A file mapped read only into memory (POSIX mmap): images are parsed and
+//  converted straight from the page cache, without read() copies, and 8 bit
+//  textures can use the mapped pixels as they are (see Texture8).
+//  The mapping lasts until Close() or the object's destruction.
+//
+
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <string>
+#include <cstddef>
+
+class MappedFile {
+    void *addr;
+    size_t length;
+public:
+    MappedFile (): addr(NULL), length(0) {}
+    ~MappedFile () { Close(); }
+    // the mapping is owned: no copies
+    MappedFile (MappedFile const&) = delete;
+    MappedFile& operator= (MappedFile const&) = delete;
+
+    // false if the file can't be opened or is empty
+    bool Open (std::string filename);
+    void Close ();
+    unsigned char const* Data () const { return (unsigned char const*)addr; }
+    size_t Size () const { return length; }
+};
+
+// header of a binary netpbm (P6) or float map (PF, Pf) file: magic, width, height and
+// maximum value (PPM) or scale (PFM) tokens, possibly with # comments, then a single
+// whitespace; offset is that of the binary data (whose size the caller must check)
+// false if the header is malformed
+bool ParsePNMHeader (MappedFile const& f, std::string *magic, int *W, int *H, std::string *maxval, size_t *offset);
+
+#endif /* MappedFile_hpp */
@@ -0,0 +1,55 @@
+//
+//  Box.cpp
+//  VI-RT
+//
+
+#include "Box.hpp"
+#include <algorithm>
+
+void Box::Filter (int const W, int const H, RGB const* imageIn, RGB *imageOut, int const nThreads) const {
+    int const r = radius;
+    size_t const N = (size_t)W * H;
+    if (Y.size() < N) Y.resize(N);
+    if (rowSum.size() < N) rowSum.resize(N);
+    float *Yp = Y.data();
+    float *Hs = rowSum.data();
+
+    Luminance(W, H, imageIn, Yp, nThreads);
+
+    // sums along the rows: the window slides one pixel, one value enters and one leaves
+    // (the sums are kept in double, so that a very bright pixel leaves no residue)
+    ParallelRows(H, nThreads, 16, [&](int const y0, int const y1) {
+        for (int y = y0; y < y1; y++) {
+            float const* row = Yp + (size_t)y * W;
+            float *out = Hs + (size_t)y * W;
+            double sum = 0.;
+            for (int u = -r; u <= r; u++) sum += row[Clamp(u, W)];
+            for (int x = 0; x < W; x++) {
+                out[x] = (float)sum;
+                sum += (double)row[Clamp(x + r + 1, W)] - row[Clamp(x - r, W)];
+            }
+        }
+    });
+
+    // sums along the columns, for all the columns of a band of rows at once;
+    // each band starts its sums from scratch, so bands are large compared with the window
+    float const norm = 1.f / ((2 * r + 1) * (2 * r + 1));
+    int const band = std::max(64, 4 * (2 * r + 1));
+    ParallelRows(H, nThreads, band, [&](int const y0, int const y1) {
+        std::vector<double> colSum(W, 0.);
+        for (int v = -r; v <= r; v++) {
+            float const* row = Hs + (size_t)Clamp(y0 + v, H) * W;
+            for (int x = 0; x < W; x++) colSum[x] += row[x];
+        }
+        for (int y = y0; y < y1; y++) {
+            size_t const row_off = (size_t)y * W;
+            for (int x = 0; x < W; x++) {
+                imageOut[row_off + x] = Rescale(imageIn[row_off + x], Yp[row_off + x], (float)colSum[x] * norm);
+            }
+            if (y + 1 == y1) break;
+            float const* enter = Hs + (size_t)Clamp(y + r + 1, H) * W;
+            float const* leave = Hs + (size_t)Clamp(y - r, H) * W;
+            for (int x = 0; x < W; x++) colSum[x] += (double)enter[x] - leave[x];
+        }
+    });
+}
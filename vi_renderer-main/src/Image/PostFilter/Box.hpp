@@ -4,45 +4,27 @@
 //
 //  Created by Luis Paulo Santos on 26/03/2025.
 //
+//  Box filter of the luminance over a (2*radius+1)^2 window, separable:
+//  running sums along the rows and then along the columns, so the cost per
+//  pixel does not depend on the radius.
+//
 
 #ifndef Box_hpp
 #define Box_hpp
 
-#include "vector.hpp"
-
-class Box  {
+#include "PostFilter.hpp"
+#include <vector>
 
-    const int margin=3;
-    const int hmargin=1;
-    const float mSq = margin*margin;
+class Box: public PostFilter {
+    int radius;
+    // scratch planes, kept from one image to the next
+    mutable std::vector<float> Y;       // luminance
+    mutable std::vector<float> rowSum;  // sums along the rows
 
 public:
-    Box () {}
-    void Filter (int const W, int const H, RGB *imageIn, RGB *imageOut) {
-        for (int y=hmargin ; y<H-hmargin ; y++) {
-            int const row_off = y*W;
-            for (int x=hmargin ; x<W-hmargin ; x++) {
-                int const offset = row_off + x;
-                RGB  Cin = imageIn[offset];
-                float const Lin = Cin.Y();
-                if (abs(Lin) < EPSILON ) {
-                    imageOut[offset] = Cin;
-                    continue;
-                }
-                float sumL=0.f;
-                for (int v=-hmargin ; v<(hmargin+1) ; v++) {
-                    int const row_off_uv = (y+v)*W;
-                    for (int u=-hmargin ; u<(hmargin+1) ; u++) {
-                        int const offset_uv = row_off_uv + x+u;
-                        sumL += imageIn[offset_uv].Y();
-                    }
-                }
-                float  Lout = sumL / mSq;
-                RGB Cout = Cin * Lout / Lin;
-                imageOut[offset] = Cout;
-            }
-        }
-    }
+    Box (int const _radius = 1): radius(_radius) {}
+    const char *Name () const { return "Box"; }
+    void Filter (int const W, int const H, RGB const* imageIn, RGB *imageOut, int const nThreads = 0) const;
 };
 
 #endif /* Box_hpp */
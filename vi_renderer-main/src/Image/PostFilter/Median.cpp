@@ -0,0 +1,117 @@
+//
+//  Median.cpp
+//  VI-RT
+//
+
+#include "Median.hpp"
+#include <algorithm>
+
+// pixels per block of the selection networks
+#define MEDIAN_BLOCK 64
+
+// compare-exchange: p[a] <= p[b]
+#define CMP_SWAP(a, b) { float const t = std::min(p[a], p[b]); p[b] = std::max(p[a], p[b]); p[a] = t; }
+
+// median of 9 values in 19 compare-exchanges (Paeth; see Devillard, "Fast median search: an ANSI C implementation")
+static inline float Median9 (float *p) {
+    CMP_SWAP(1, 2) CMP_SWAP(4, 5) CMP_SWAP(7, 8) CMP_SWAP(0, 1) CMP_SWAP(3, 4) CMP_SWAP(6, 7)
+    CMP_SWAP(1, 2) CMP_SWAP(4, 5) CMP_SWAP(7, 8) CMP_SWAP(0, 3) CMP_SWAP(5, 8) CMP_SWAP(4, 7)
+    CMP_SWAP(3, 6) CMP_SWAP(1, 4) CMP_SWAP(2, 5) CMP_SWAP(4, 7) CMP_SWAP(4, 2) CMP_SWAP(6, 4)
+    CMP_SWAP(4, 2)
+    return p[4];
+}
+
+// median of 25 values in 99 compare-exchanges (Smith; see Devillard)
+static inline float Median25 (float *p) {
+    CMP_SWAP(0, 1)   CMP_SWAP(3, 4)   CMP_SWAP(2, 4)   CMP_SWAP(2, 3)   CMP_SWAP(6, 7)   CMP_SWAP(5, 7)
+    CMP_SWAP(5, 6)   CMP_SWAP(9, 10)  CMP_SWAP(8, 10)  CMP_SWAP(8, 9)   CMP_SWAP(12, 13) CMP_SWAP(11, 13)
+    CMP_SWAP(11, 12) CMP_SWAP(15, 16) CMP_SWAP(14, 16) CMP_SWAP(14, 15) CMP_SWAP(18, 19) CMP_SWAP(17, 19)
+    CMP_SWAP(17, 18) CMP_SWAP(21, 22) CMP_SWAP(20, 22) CMP_SWAP(20, 21) CMP_SWAP(23, 24) CMP_SWAP(2, 5)
+    CMP_SWAP(3, 6)   CMP_SWAP(0, 6)   CMP_SWAP(0, 3)   CMP_SWAP(4, 7)   CMP_SWAP(1, 7)   CMP_SWAP(1, 4)
+    CMP_SWAP(11, 14) CMP_SWAP(8, 14)  CMP_SWAP(8, 11)  CMP_SWAP(12, 15) CMP_SWAP(9, 15)  CMP_SWAP(9, 12)
+    CMP_SWAP(13, 16) CMP_SWAP(10, 16) CMP_SWAP(10, 13) CMP_SWAP(20, 23) CMP_SWAP(17, 23) CMP_SWAP(17, 20)
+    CMP_SWAP(21, 24) CMP_SWAP(18, 24) CMP_SWAP(18, 21) CMP_SWAP(19, 22) CMP_SWAP(8, 17)  CMP_SWAP(9, 18)
+    CMP_SWAP(0, 18)  CMP_SWAP(0, 9)   CMP_SWAP(10, 19) CMP_SWAP(1, 19)  CMP_SWAP(1, 10)  CMP_SWAP(11, 20)
+    CMP_SWAP(2, 20)  CMP_SWAP(2, 11)  CMP_SWAP(12, 21) CMP_SWAP(3, 21)  CMP_SWAP(3, 12)  CMP_SWAP(13, 22)
+    CMP_SWAP(4, 22)  CMP_SWAP(4, 13)  CMP_SWAP(14, 23) CMP_SWAP(5, 23)  CMP_SWAP(5, 14)  CMP_SWAP(15, 24)
+    CMP_SWAP(6, 24)  CMP_SWAP(6, 15)  CMP_SWAP(7, 16)  CMP_SWAP(7, 19)  CMP_SWAP(13, 21) CMP_SWAP(15, 23)
+    CMP_SWAP(7, 13)  CMP_SWAP(7, 15)  CMP_SWAP(1, 9)   CMP_SWAP(3, 11)  CMP_SWAP(5, 17)  CMP_SWAP(11, 17)
+    CMP_SWAP(9, 17)  CMP_SWAP(4, 10)  CMP_SWAP(6, 12)  CMP_SWAP(7, 14)  CMP_SWAP(4, 6)   CMP_SWAP(4, 7)
+    CMP_SWAP(12, 14) CMP_SWAP(10, 14) CMP_SWAP(6, 7)   CMP_SWAP(10, 12) CMP_SWAP(6, 10)  CMP_SWAP(6, 17)
+    CMP_SWAP(12, 17) CMP_SWAP(7, 17)  CMP_SWAP(7, 10)  CMP_SWAP(12, 18) CMP_SWAP(7, 12)  CMP_SWAP(10, 18)
+    CMP_SWAP(12, 20) CMP_SWAP(10, 20) CMP_SWAP(10, 12)
+    return p[12];
+}
+
+void Median::MedianRow (int const Wp, float const* top, int const x0, int const n, float *med, std::vector<float>& window) const {
+    int const k = 2 * radius + 1;
+    top += x0;
+
+    if (k == 3) {
+        float const* r0 = top;
+        float const* r1 = top + Wp;
+        float const* r2 = top + 2 * Wp;
+        for (int i = 0; i < n; i++) {
+            float p[9] = {r0[i], r0[i+1], r0[i+2], r1[i], r1[i+1], r1[i+2], r2[i], r2[i+1], r2[i+2]};
+            med[i] = Median9(p);
+        }
+    }
+    else if (k == 5) {
+        float const* r0 = top;
+        float const* r1 = top + Wp;
+        float const* r2 = top + 2 * Wp;
+        float const* r3 = top + 3 * Wp;
+        float const* r4 = top + 4 * Wp;
+        for (int i = 0; i < n; i++) {
+            float p[25] = {r0[i], r0[i+1], r0[i+2], r0[i+3], r0[i+4],
+                           r1[i], r1[i+1], r1[i+2], r1[i+3], r1[i+4],
+                           r2[i], r2[i+1], r2[i+2], r2[i+3], r2[i+4],
+                           r3[i], r3[i+1], r3[i+2], r3[i+3], r3[i+4],
+                           r4[i], r4[i+1], r4[i+2], r4[i+3], r4[i+4]};
+            med[i] = Median25(p);
+        }
+    }
+    else {
+        int const mid = k * k / 2;
+        for (int i = 0; i < n; i++) {
+            for (int v = 0; v < k; v++) {
+                std::copy(top + v * Wp + i, top + v * Wp + i + k, window.begin() + v * k);
+            }
+            std::nth_element(window.begin(), window.begin() + mid, window.end());
+            med[i] = window[mid];
+        }
+    }
+}
+
+void Median::Filter (int const W, int const H, RGB const* imageIn, RGB *imageOut, int const nThreads) const {
+    int const r = radius;
+    int const Wp = W + 2 * r;
+    int const Hp = H + 2 * r;
+    if (padded.size() < (size_t)Wp * Hp) padded.resize((size_t)Wp * Hp);
+    float *P = padded.data();
+
+    // luminance, with the border pixels replicated r times around the image
+    ParallelRows(Hp, nThreads, 16, [&](int const y0, int const y1) {
+        for (int y = y0; y < y1; y++) {
+            RGB const* in = imageIn + (size_t)Clamp(y - r, H) * W;
+            float *out = P + (size_t)y * Wp;
+            for (int x = 0; x < Wp; x++) out[x] = in[Clamp(x - r, W)].Y();
+        }
+    });
+
+    ParallelRows(H, nThreads, 8, [&](int const y0, int const y1) {
+        float med[MEDIAN_BLOCK];
+        std::vector<float> window((2 * r + 1) * (2 * r + 1));
+        for (int y = y0; y < y1; y++) {
+            size_t const row_off = (size_t)y * W;
+            for (int x0 = 0; x0 < W; x0 += MEDIAN_BLOCK) {
+                int const n = std::min(MEDIAN_BLOCK, W - x0);
+                MedianRow(Wp, P + (size_t)y * Wp, x0, n, med, window);
+                for (int i = 0; i < n; i++) {
+                    int const x = x0 + i;
+                    imageOut[row_off + x] = Rescale(imageIn[row_off + x], P[(size_t)(y + r) * Wp + x + r], med[i]);
+                }
+            }
+        }
+    });
+}
@@ -1,50 +1,33 @@
 //
-//  Box.hpp
+//  Median.hpp
 //  VI-RT-V4-PathTracing
 //
 //  Created by Luis Paulo Santos on 26/03/2025.
 //
+//  Median filter of the luminance over a (2*radius+1)^2 window.
+//  3x3 and 5x5 windows use selection networks (only min / max, no branches),
+//  evaluated for a block of pixels at a time so that the compiler vectorizes
+//  them across pixels; larger windows use std::nth_element.
+//
 
 #ifndef Median_hpp
 #define Median_hpp
 
+#include "PostFilter.hpp"
 #include <vector>
-#include <algorithm>
-#include "vector.hpp"
 
-class Median  {
-    const int margin=5;
-    const int hmargin=2;
-    const int median_ndx = 12;
+class Median: public PostFilter {
+    int radius;
+    // luminance with a border of radius pixels, kept from one image to the next
+    mutable std::vector<float> padded;
+
+    // the median luminance of pixels [x0,x0+n[ of the row whose window starts at padded row 'top'
+    void MedianRow (int const Wp, float const* top, int const x0, int const n, float *med, std::vector<float>& window) const;
 
 public:
-    Median () {}
-    void Filter (int const W, int const H, RGB *imageIn, RGB *imageOut) {
-        for (int y=hmargin ; y<H-hmargin ; y++) {
-            int const row_off = y*W;
-            for (int x=hmargin ; x<W-hmargin ; x++) {
-                int const offset = row_off + x;
-                RGB  Cin = imageIn[offset];
-                float const Lin = Cin.Y();
-                if (abs(Lin) < EPSILON ) {
-                    imageOut[offset] = Cin;
-                    continue;
-                }
-                std::vector<float> window;
-                for (int v=-hmargin ; v<(hmargin+1) ; v++) {
-                    int const row_off_uv = (y+v)*W;
-                    for (int u=-hmargin ; u<(hmargin+1) ; u++) {
-                        int const offset_uv = row_off_uv + x+u;
-                        window.push_back(imageIn[offset_uv].Y());
-                    }
-                }
-                std::sort(window.begin(), window.end());
-                float  Lout = window[median_ndx];
-                RGB Cout = Cin * Lout / Lin;
-                imageOut[offset] = Cout;
-            }
-        }
-    }
+    Median (int const _radius = 2): radius(_radius) {}
+    const char *Name () const { return "Median"; }
+    void Filter (int const W, int const H, RGB const* imageIn, RGB *imageOut, int const nThreads = 0) const;
 };
 
 #endif /* Median_hpp */
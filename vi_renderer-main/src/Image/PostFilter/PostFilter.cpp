@@ -0,0 +1,39 @@
+//
+//  PostFilter.cpp
+//  VI-RT
+//
+
+#include "PostFilter.hpp"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+void PostFilter::ParallelRows (int const H, int const nThreads, int const rowsPerTask,
+                               std::function<void(int, int)> const& rows) {
+    int threads = nThreads;
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+    int const nTasks = (H + rowsPerTask - 1) / rowsPerTask;
+    threads = std::max(1, std::min(threads, nTasks));
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        int task;
+        while ((task = next++) < nTasks) {
+            int const y0 = task * rowsPerTask;
+            rows(y0, std::min(y0 + rowsPerTask, H));
+        }
+    };
+    // the calling thread is a worker too
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) pool.push_back(std::thread(worker));
+    worker();
+    for (auto &t : pool) t.join();
+}
+
+void PostFilter::Luminance (int const W, int const H, RGB const* imageIn, float *Y, int const nThreads) {
+    ParallelRows(H, nThreads, 16, [&](int const y0, int const y1) {
+        for (size_t i = (size_t)y0 * W; i < (size_t)y1 * W; i++) Y[i] = imageIn[i].Y();
+    });
+}
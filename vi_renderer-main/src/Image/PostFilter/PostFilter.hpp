@@ -0,0 +1,42 @@
+//
+//  PostFilter.hpp
+//  VI-RT
+//
+//  Image space filters applied after rendering (usually to the HDR image,
+//  before tone mapping). A filter writes every pixel of imageOut, which
+//  must not be imageIn.
+//  The filters smooth the luminance, Y, and scale each pixel's colour by
+//  Yout/Yin, so that hue is preserved. Outside the image the nearest border
+//  pixel is replicated.
+//
+
+#ifndef PostFilter_hpp
+#define PostFilter_hpp
+
+#include "RGB.hpp"
+#include "vector.hpp"
+#include <cmath>
+#include <functional>
+
+class PostFilter {
+protected:
+    // runs rows(y0, y1) over [0,H[ in chunks of rowsPerTask rows, on nThreads threads
+    // (0 : std::thread::hardware_concurrency())
+    static void ParallelRows (int const H, int const nThreads, int const rowsPerTask,
+                              std::function<void(int, int)> const& rows);
+    // Y of each pixel, into Y[W*H]
+    static void Luminance (int const W, int const H, RGB const* imageIn, float *Y, int const nThreads);
+    static int Clamp (int const i, int const n) { return (i < 0) ? 0 : ((i >= n) ? n - 1 : i); }
+    // the colour Cin, of luminance Lin, with luminance Lout
+    static RGB Rescale (RGB Cin, float const Lin, float const Lout) {
+        if (fabsf(Lin) < EPSILON) return Cin;
+        return Cin * (Lout / Lin);
+    }
+public:
+    virtual ~PostFilter () {}
+    virtual const char *Name () const = 0;
+    // nThreads = 0 : std::thread::hardware_concurrency()
+    virtual void Filter (int const W, int const H, RGB const* imageIn, RGB *imageOut, int const nThreads = 0) const = 0;
+};
+
+#endif /* PostFilter_hpp */
@@ -0,0 +1,157 @@
+//
+//  PostProcess.cpp
+//  VI-RT
+//
+
+#include "PostProcess.hpp"
+#include "ACES.hpp"
+#include "Exposure.hpp"
+#include "ReinhardBasic.hpp"
+#include "ReinhardAdvanced.hpp"
+#include "Box.hpp"
+#include "Median.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <sstream>
+
+void PostProcess::Add (ToneMapper *tm) {
+    Stage s = {tm, NULL};
+    stages.push_back(s);
+}
+
+void PostProcess::Add (PostFilter *pf) {
+    Stage s = {NULL, pf};
+    stages.push_back(s);
+}
+
+void PostProcess::Clear () {
+    for (auto &s : stages) {
+        if (s.tm != NULL) delete s.tm;
+        if (s.pf != NULL) delete s.pf;
+    }
+    stages.clear();
+}
+
+static std::vector<std::string> Split (std::string const& str, char const sep) {
+    std::vector<std::string> tokens;
+    std::stringstream ss(str);
+    std::string token;
+    while (std::getline(ss, token, sep)) tokens.push_back(token);
+    return tokens;
+}
+
+bool PostProcess::Parse (std::string const& spec) {
+    std::vector<Stage> parsed;
+    try {
+        for (auto const& desc : Split(spec, ',')) {
+            std::vector<std::string> tokens = Split(desc, ':');
+            if (tokens.empty() || tokens[0].empty()) throw("PostProcess: empty stage");
+            std::string const& name = tokens[0];
+            // parameters, NAN if omitted
+            float p[2] = {NAN, NAN};
+            if (tokens.size() > 3) throw("PostProcess: too many parameters");
+            for (size_t i = 1 ; i < tokens.size() ; i++) {
+                char *end;
+                p[i-1] = strtof(tokens[i].c_str(), &end);
+                if (tokens[i].empty() || *end != '\0' || !(p[i-1] > 0.f)) throw("PostProcess: parameters must be positive numbers");
+            }
+            float const p0 = std::isnan(p[0]) ? 1.0f : p[0];
+            float const gamma = std::isnan(p[1]) ? 2.2f : p[1];
+
+            Stage s = {NULL, NULL};
+            if (name == "box" || name == "median") {
+                if (tokens.size() > 2) throw("PostProcess: filters take a single parameter");
+                if (!std::isnan(p[0]) && p[0] != floorf(p[0])) throw("PostProcess: the filter radius must be an integer");
+                if (name == "box") s.pf = std::isnan(p[0]) ? new Box() : new Box((int)p[0]);
+                else s.pf = std::isnan(p[0]) ? new Median() : new Median((int)p[0]);
+            }
+            else if (name == "aces") s.tm = new ACES(p0, gamma);
+            else if (name == "exposure") s.tm = new Exposure(p0, gamma);
+            else if (name == "linear") s.tm = new Linear(p0, gamma);
+            else if (name == "reinhard") s.tm = new ReinhardBasic(p0, std::isnan(p[1]) ? 1.0f : p[1]);
+            else if (name == "reinhard-advanced") s.tm = new ReinhardAdvanced(p0, gamma);
+            else throw("PostProcess: unknown stage");
+            parsed.push_back(s);
+        }
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s in \"%s\"\n", err, spec.c_str());
+        for (auto &s : parsed) {
+            if (s.tm != NULL) delete s.tm;
+            if (s.pf != NULL) delete s.pf;
+        }
+        return false;
+    }
+    stages.insert(stages.end(), parsed.begin(), parsed.end());
+    return true;
+}
+
+std::string PostProcess::Describe () const {
+    if (stages.empty()) return "none";
+    std::string desc;
+    for (auto const& s : stages) {
+        if (!desc.empty()) desc += " -> ";
+        desc += (s.tm != NULL) ? s.tm->Name() : s.pf->Name();
+    }
+    return desc;
+}
+
+RGB const* PostProcess::Run (int const W, int const H, RGB const* imageIn, int const n) {
+    size_t const N = (size_t)W * H;
+    RGB const* cur = imageIn;
+
+    for (int i = 0 ; i < n ; i++) {
+        Stage const& s = stages[i];
+        RGB *dst;
+        if (s.tm != NULL) {
+            // tone mappers run in place, once the image is in one of the buffers
+            if (cur != imageIn) dst = const_cast<RGB *>(cur);
+            else {
+                if (ping.size() < N) ping.resize(N);
+                dst = ping.data();
+            }
+            s.tm->ToneMap(W, H, cur, dst, nThreads);
+        }
+        else {
+            // filters write to the other buffer
+            std::vector<RGB> &buf = (cur == ping.data()) ? pong : ping;
+            if (buf.size() < N) buf.resize(N);
+            dst = buf.data();
+            s.pf->Filter(W, H, cur, dst, nThreads);
+        }
+        cur = dst;
+    }
+    return cur;
+}
+
+RGB const* PostProcess::Apply (int const W, int const H, RGB const* imageIn) {
+    return Run(W, H, imageIn, (int)stages.size());
+}
+
+void PostProcess::Apply8 (int const W, int const H, RGB const* imageIn, char_pixel *imageOut,
+                          RGB *hdrMin, RGB *hdrMax) {
+    int n = (int)stages.size();
+    // the last tone mapper is fused with the quantization
+    ToneMapper const* last = &clamp;
+    if (n > 0 && stages[n-1].tm != NULL) last = stages[--n].tm;
+
+    bool const range = (hdrMin != NULL && hdrMax != NULL);
+    if (range && n > 0) {
+        // the fused pass does not read imageIn
+        *hdrMin = RGB(INFINITY, INFINITY, INFINITY);
+        *hdrMax = RGB(-INFINITY, -INFINITY, -INFINITY);
+        for (size_t i = 0 ; i < (size_t)W * H ; i++) {
+            hdrMin->R = std::min(hdrMin->R, imageIn[i].R);
+            hdrMin->G = std::min(hdrMin->G, imageIn[i].G);
+            hdrMin->B = std::min(hdrMin->B, imageIn[i].B);
+            hdrMax->R = std::max(hdrMax->R, imageIn[i].R);
+            hdrMax->G = std::max(hdrMax->G, imageIn[i].G);
+            hdrMax->B = std::max(hdrMax->B, imageIn[i].B);
+        }
+    }
+    RGB const* cur = Run(W, H, imageIn, n);
+    last->ToneMap8(W, H, cur, imageOut, nThreads,
+                   (range && n == 0) ? hdrMin : NULL, (range && n == 0) ? hdrMax : NULL);
+}
@@ -0,0 +1,65 @@
+//
+//  PostProcess.hpp
+//  VI-RT
+//
+//  A post-processing pipeline configured at runtime: a chain of PostFilters
+//  and tone mappers applied to an HDR image, e.g. "median,aces:1.5:2.2".
+//  The source image is not modified, so several variants can be produced from
+//  the same render. Stages ping-pong between two buffers that are kept from one
+//  run to the next (and only reallocated if the resolution grows); tone mappers
+//  run in place, and a final tone mapper is fused with the 8 bit quantization.
+//
+
+#ifndef PostProcess_hpp
+#define PostProcess_hpp
+
+#include "RGB.hpp"
+#include "image.hpp"
+#include "ToneMapper.hpp"
+#include "Linear.hpp"
+#include "PostFilter.hpp"
+#include <string>
+#include <vector>
+
+class PostProcess {
+    // each stage is either a tone mapper or a filter (owned by the pipeline)
+    typedef struct {
+        ToneMapper *tm;
+        PostFilter *pf;
+    } Stage;
+    std::vector<Stage> stages;
+    std::vector<RGB> ping, pong;
+    Linear clamp;       // quantization when the last stage is not a tone mapper
+    int nThreads;
+
+    // runs stages [0,n[ on imageIn ; returns the result (imageIn itself if n == 0)
+    RGB const* Run (int const W, int const H, RGB const* imageIn, int const n);
+public:
+    // nThreads = 0 : std::thread::hardware_concurrency()
+    PostProcess (int const _nThreads = 0): clamp(1.0f, 1.0f), nThreads(_nThreads) {}
+    ~PostProcess () { Clear(); }
+    PostProcess (PostProcess const&) = delete;
+    PostProcess& operator= (PostProcess const&) = delete;
+
+    // appended stages belong to the pipeline
+    void Add (ToneMapper *tm);
+    void Add (PostFilter *pf);
+    void Clear ();
+    // appends the stages in spec: comma separated, each name[:param[:param]]
+    //   box[:radius] | median[:radius]      (windows of (2*radius+1)^2 pixels, 1 and 2 by default)
+    //   aces[:exposure[:gamma]] | exposure[:exposure[:gamma]] | linear[:exposure[:gamma]]
+    //   reinhard[:exposure[:gamma]] | reinhard-advanced[:white_point[:gamma]]
+    // omitted parameters take the classes' defaults ; false (and nothing appended) on error
+    bool Parse (std::string const& spec);
+    // the stages' names, " -> " separated
+    std::string Describe () const;
+
+    // all the stages, into a buffer of the pipeline (valid until the next run)
+    RGB const* Apply (int const W, int const H, RGB const* imageIn);
+    // all the stages and the quantization to 8 bits (clamp only if no stage is a tone mapper)
+    // hdrMin, hdrMax (optional): per component range of imageIn
+    void Apply8 (int const W, int const H, RGB const* imageIn, char_pixel *imageOut,
+                 RGB *hdrMin = NULL, RGB *hdrMax = NULL);
+};
+
+#endif /* PostProcess_hpp */
@@ -0,0 +1,50 @@
+//
+//  Texture8.cpp
+//  VI-RT
+//
+
+#include "Texture8.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+bool Texture8::Load (std::string filename) {
+    pixels = NULL;
+    W = H = 0;
+    converted.clear();
+    try {
+        if (!file.Open(filename)) throw("Can't open input file");
+        std::string magic, maxval;
+        int w, h;
+        size_t offset;
+        if (!ParsePNMHeader(file, &magic, &w, &h, &maxval, &offset) || magic != "P6") throw("Can't read input file");
+        int const maxv = atoi(maxval.c_str());
+        if (maxv <= 0 || maxv > 65535) throw("Can't read input file");
+        size_t const bytes = (maxv < 256) ? 1 : 2;
+        size_t const n = (size_t)w * h;
+        if (file.Size() - offset < n * 3 * bytes) throw("Truncated input file");
+
+        unsigned char const* in = file.Data() + offset;
+        if (maxv == 255) {
+            pixels = reinterpret_cast<char_pixel const*>(in);
+        }
+        else {
+            // rescaled to [0,255] (16 bit components are reduced to 8 bits)
+            converted.resize(n);
+            unsigned char *out = &converted[0].val[0];
+            for (size_t i = 0 ; i < 3 * n ; i++) {
+                unsigned int const v = (bytes == 1) ? in[i] : ((in[2*i] << 8) | in[2*i+1]);
+                out[i] = (unsigned char)((v * 255u + maxv / 2) / maxv);
+            }
+            file.Close();
+            pixels = converted.data();
+        }
+        W = w;
+        H = h;
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s %s\n", err, filename.c_str());
+        file.Close();
+        return false;
+    }
+    return true;
+}
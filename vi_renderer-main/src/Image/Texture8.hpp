@@ -0,0 +1,39 @@
+//
+//  Texture8.hpp
+//  VI-RT
+//
+//  An 8 bit RGB texture loaded from a binary PPM (P6): the pixels stay as
+//  bytes, converted to RGB on lookup, so a texture takes the size of its file
+//  instead of the 12 bytes per pixel of an Image's floats. With maxval 255 the
+//  pixels are used in place in the memory mapped file (shared with the page
+//  cache, nothing is copied); other maxvals are converted to bytes once.
+//
+
+#ifndef Texture8_hpp
+#define Texture8_hpp
+
+#include "image.hpp"
+#include "MappedFile.hpp"
+#include <vector>
+#include <string>
+
+class Texture8 {
+    MappedFile file;
+    std::vector<char_pixel> converted;   // if the file's maxval is not 255
+    char_pixel const* pixels;            // W*H, row by row from the top
+public:
+    int W, H;
+    Texture8 (): pixels(NULL), W(0), H(0) {}
+    bool Load (std::string filename);
+
+    // coordinates outside the texture are clamped to its border
+    RGB get (int x, int y) const {
+        if (pixels == NULL) return RGB(0., 0., 0.);
+        x = (x < 0) ? 0 : ((x >= W) ? W-1 : x);
+        y = (y < 0) ? 0 : ((y >= H) ? H-1 : y);
+        char_pixel const& p = pixels[y*W+x];
+        return RGB(p.val[0] / 255.f, p.val[1] / 255.f, p.val[2] / 255.f);
+    }
+};
+
+#endif /* Texture8_hpp */
@@ -7,24 +7,27 @@
 #ifndef ReinhardBasic_hpp
 #define ReinhardBasic_hpp
 
-#include "RGB.hpp"
-    
-class ReinhardBasic {
-public:
-    ReinhardBasic() {}
-    
-    void ToneMap(int const W, int const H, RGB *imageIn, RGB *imageOut) {
-        for (int y = 0; y < H; y++) {
-            int const row_off = y * W;
-            for (int x = 0; x < W; x++) {
-                int const offset = row_off + x;
-                RGB Cin = imageIn[offset];
-                float Lin = Cin.Y();  // Get luminance
-                RGB const Cout = Cin / (1.0f + Lin);  // Basic Reinhard formula
-                imageOut[offset] = Cout;
-            }
+#include "ToneMapper.hpp"
+
+class ReinhardBasic: public ToneMapper {
+protected:
+    // Basic Reinhard formula: the colour is scaled by 1/(1+luminance)
+    void Curve (float *rgb, int const n) const {
+        for (int p = 0; p < n; p++) {
+            float *c = rgb + 3 * p;
+            float const scale = 1.0f / (1.0f + c[0] * 0.2126f + c[1] * 0.7152f + c[2] * 0.0722f);
+            c[0] *= scale;
+            c[1] *= scale;
+            c[2] *= scale;
         }
     }
+
+public:
+    // no gamma correction by default
+    ReinhardBasic(float _exposure = 1.0f, float _gamma = 1.0f)
+        : ToneMapper(_exposure, _gamma) {}
+
+    const char *Name () const { return "Reinhard Basic"; }
 };
 
 #endif /* ReinhardBasic_hpp */
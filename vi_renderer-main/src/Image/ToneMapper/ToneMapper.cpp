@@ -0,0 +1,144 @@
+//
+//  ToneMapper.cpp
+//  VI-RT
+//
+
+#include "ToneMapper.hpp"
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+// rows handed to a thread at a time
+#define TM_ROWS 8
+
+// float representation of 1.0f, upper 16 bits: the last entry of the gamma table
+#define LUT_ONE (0x3F800000u >> 16)
+
+static inline uint32_t FloatBits (float const f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float BitsFloat (uint32_t const u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+void ToneMapper::BuildGammaLUT () {
+    // gamma 1 : no table, values are left as they are
+    if (gamma == 1.0f) {
+        gammaLUT.clear();
+        return;
+    }
+    gammaLUT.resize(LUT_ONE + 2);
+    float const invGamma = 1.0f / gamma;
+    for (uint32_t i = 0; i <= LUT_ONE; i++) {
+        gammaLUT[i] = powf(BitsFloat(i << 16), invGamma);
+    }
+    gammaLUT[LUT_ONE + 1] = 1.0f;   // interpolation past 1.0 (never weighted)
+}
+
+inline float ToneMapper::GammaCorrect (float const x) const {
+    uint32_t const bits = FloatBits(x);
+    uint32_t const i = bits >> 16;
+    float const t = (bits & 0xFFFFu) * (1.0f / 65536.0f);
+    return gammaLUT[i] + t * (gammaLUT[i+1] - gammaLUT[i]);
+}
+
+void ToneMapper::Rows (int const W, int const y0, int const y1, RGB const* imageIn,
+                       char_pixel *out8, RGB *outF, RGB *hdrMin, RGB *hdrMax) const {
+    float buf[3 * TM_BLOCK];
+    bool const useLUT = !gammaLUT.empty();
+    float const e = exposure;
+
+    for (int y = y0; y < y1; y++) {
+        for (int x0 = 0; x0 < W; x0 += TM_BLOCK) {
+            int const n = std::min(TM_BLOCK, W - x0);
+            int const n3 = 3 * n;
+            size_t const offset = (size_t)y * W + x0;
+            float const* in = reinterpret_cast<float const*>(imageIn + offset);
+
+            if (hdrMin != NULL) {
+                for (int p = 0; p < n; p++) {
+                    hdrMin->R = std::min(hdrMin->R, in[3*p]);
+                    hdrMin->G = std::min(hdrMin->G, in[3*p+1]);
+                    hdrMin->B = std::min(hdrMin->B, in[3*p+2]);
+                    hdrMax->R = std::max(hdrMax->R, in[3*p]);
+                    hdrMax->G = std::max(hdrMax->G, in[3*p+1]);
+                    hdrMax->B = std::max(hdrMax->B, in[3*p+2]);
+                }
+            }
+            // exposure, curve and clamp
+            for (int i = 0; i < n3; i++) buf[i] = in[i] * e;
+            Curve(buf, n);
+            for (int i = 0; i < n3; i++) buf[i] = std::max(0.0f, std::min(1.0f, buf[i]));
+            // gamma
+            if (useLUT) {
+                for (int i = 0; i < n3; i++) buf[i] = GammaCorrect(buf[i]);
+            }
+            // output
+            if (out8 != NULL) {
+                unsigned char *out = &out8[offset].val[0];
+                for (int i = 0; i < n3; i++) out[i] = (unsigned char)(buf[i] * 255);
+            }
+            else {
+                memcpy((void *)(outF + offset), buf, n3 * sizeof(float));
+            }
+        }
+    }
+}
+
+void ToneMapper::Run (int const W, int const H, RGB const* imageIn, char_pixel *out8, RGB *outF,
+                      int nThreads, RGB *hdrMin, RGB *hdrMax) const {
+    if (nThreads <= 0) nThreads = (int)std::thread::hardware_concurrency();
+    if (nThreads <= 0) nThreads = 1;
+    int const nChunks = (H + TM_ROWS - 1) / TM_ROWS;
+    nThreads = std::max(1, std::min(nThreads, nChunks));
+
+    // per thread ranges, merged at the end
+    bool const range = (hdrMin != NULL && hdrMax != NULL);
+    std::vector<RGB> mins(nThreads, RGB(INFINITY, INFINITY, INFINITY));
+    std::vector<RGB> maxs(nThreads, RGB(-INFINITY, -INFINITY, -INFINITY));
+
+    std::atomic<int> next(0);
+    auto worker = [&](int const t) {
+        int chunk;
+        while ((chunk = next++) < nChunks) {
+            int const y0 = chunk * TM_ROWS;
+            Rows(W, y0, std::min(y0 + TM_ROWS, H), imageIn, out8, outF,
+                 range ? &mins[t] : NULL, range ? &maxs[t] : NULL);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < nThreads; t++) pool.push_back(std::thread(worker, t));
+    worker(0);
+    for (auto &t : pool) t.join();
+
+    if (range) {
+        *hdrMin = mins[0];
+        *hdrMax = maxs[0];
+        for (int t = 1; t < nThreads; t++) {
+            hdrMin->R = std::min(hdrMin->R, mins[t].R);
+            hdrMin->G = std::min(hdrMin->G, mins[t].G);
+            hdrMin->B = std::min(hdrMin->B, mins[t].B);
+            hdrMax->R = std::max(hdrMax->R, maxs[t].R);
+            hdrMax->G = std::max(hdrMax->G, maxs[t].G);
+            hdrMax->B = std::max(hdrMax->B, maxs[t].B);
+        }
+    }
+}
+
+void ToneMapper::ToneMap (int const W, int const H, RGB const* imageIn, RGB *imageOut,
+                          int const nThreads, RGB *hdrMin, RGB *hdrMax) const {
+    Run(W, H, imageIn, NULL, imageOut, nThreads, hdrMin, hdrMax);
+}
+
+void ToneMapper::ToneMap8 (int const W, int const H, RGB const* imageIn, char_pixel *imageOut,
+                           int const nThreads, RGB *hdrMin, RGB *hdrMax) const {
+    Run(W, H, imageIn, imageOut, NULL, nThreads, hdrMin, hdrMax);
+}
@@ -0,0 +1,67 @@
+//
+//  ToneMapper.hpp
+//  VI-RT
+//
+//  Tone mapping of an HDR image in a single pass over its pixels: exposure,
+//  tone curve, clamp to [0,1], gamma correction and (ToneMap8) quantization
+//  to 8 bits, fused per block of TM_BLOCK pixels that stays in the L1 cache.
+//  The element wise stages are plain loops over the block's floats, written
+//  so that the compiler vectorizes them (SSE, or AVX with SIMDFLAGS); gamma
+//  uses a lookup table instead of powf. Rows are distributed among threads.
+//  Each tone mapper only provides its curve.
+//
+
+#ifndef ToneMapper_hpp
+#define ToneMapper_hpp
+
+#include "RGB.hpp"
+#include "image.hpp"
+#include <vector>
+
+// pixels per block of the fused pass
+#define TM_BLOCK 256
+
+class ToneMapper {
+protected:
+    float exposure;
+    float gamma;
+
+    // the tone curve, in place, on the exposed radiance of n <= TM_BLOCK pixels
+    // (3n floats, RGB interleaved); the result is clamped to [0,1] afterwards
+    virtual void Curve (float *rgb, int const n) const = 0;
+
+private:
+    // x^(1/gamma) for x in [0,1], indexed by the upper 16 bits of x's float representation
+    // (exponent and 7 mantissa bits) and linearly interpolated with the lower 16 bits:
+    // uniform relative precision over the whole range, down to the denormals
+    std::vector<float> gammaLUT;
+    void BuildGammaLUT ();
+    float GammaCorrect (float const x) const;
+
+    // the fused pass over rows [y0,y1[ ; out8 or outF is the output
+    void Rows (int const W, int const y0, int const y1, RGB const* imageIn,
+               char_pixel *out8, RGB *outF, RGB *hdrMin, RGB *hdrMax) const;
+    void Run (int const W, int const H, RGB const* imageIn, char_pixel *out8, RGB *outF,
+              int nThreads, RGB *hdrMin, RGB *hdrMax) const;
+
+public:
+    ToneMapper (float const _exposure = 1.0f, float const _gamma = 2.2f): exposure(_exposure), gamma(_gamma) {
+        BuildGammaLUT();
+    }
+    virtual ~ToneMapper () {}
+    virtual const char *Name () const = 0;
+
+    // LDR image: gamma corrected values in [0,1] ; imageOut may be imageIn
+    // nThreads = 0 : std::thread::hardware_concurrency()
+    // hdrMin, hdrMax (optional): per component range of imageIn, found in the same pass
+    void ToneMap (int const W, int const H, RGB const* imageIn, RGB *imageOut,
+                  int const nThreads = 0, RGB *hdrMin = NULL, RGB *hdrMax = NULL) const;
+    // the same, quantized to 8 bits per component as ImagePPM saves them
+    void ToneMap8 (int const W, int const H, RGB const* imageIn, char_pixel *imageOut,
+                   int const nThreads = 0, RGB *hdrMin = NULL, RGB *hdrMax = NULL) const;
+
+    void setExposure (float const exp) { exposure = exp; }
+    void setGamma (float const g) { gamma = g; BuildGammaLUT(); }
+};
+
+#endif /* ToneMapper_hpp */
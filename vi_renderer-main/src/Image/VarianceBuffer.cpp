@@ -0,0 +1,114 @@
+//
+//  VarianceBuffer.cpp
+//  VI-RT
+//
+
+#include "VarianceBuffer.hpp"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char CheckpointMagic[8] = {'V','I','R','T','A','C','C','2'};
+static const int SamplerNameSize = 32;
+
+template <typename T>
+static void write (std::ofstream& ofs, T const& v) { ofs.write((char const *)&v, sizeof(T)); }
+template <typename T>
+static void read (std::ifstream& ifs, T& v) { ifs.read((char *)&v, sizeof(T)); }
+
+// flush the file's data to the disk, so that the rename never publishes a partial checkpoint
+static bool sync (std::string const& filename) {
+    int const fd = open(filename.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool const ok = (fsync(fd) == 0);
+    close(fd);
+    return ok;
+}
+
+bool VarianceBuffer::Save (std::string filename, int const progress, CheckpointInfo const& info) {
+    std::string const tmp = filename + ".tmp";
+    std::ofstream ofs;
+    try {
+        char sampler[SamplerNameSize] = {0};
+        strncpy(sampler, info.sampler.c_str(), SamplerNameSize - 1);
+
+        ofs.open(tmp, std::ios::binary);
+        if (ofs.fail()) throw("Can't open checkpoint file");
+        ofs.write(CheckpointMagic, sizeof(CheckpointMagic));
+        write(ofs, W);
+        write(ofs, H);
+        write(ofs, progress);
+        write(ofs, info.seed);
+        write(ofs, info.spp);
+        ofs.write(sampler, sizeof(sampler));
+        write(ofs, info.sceneHash);
+        for (PixelStats const& ps : stats) {
+            write(ofs, ps.n);
+            write(ofs, ps.sum.R);
+            write(ofs, ps.sum.G);
+            write(ofs, ps.sum.B);
+            write(ofs, ps.meanY);
+            write(ofs, ps.M2);
+        }
+        ofs.close();
+        if (ofs.fail()) throw("Can't write checkpoint file");
+        if (!sync(tmp)) throw("Can't sync checkpoint file");
+        if (std::rename(tmp.c_str(), filename.c_str()) != 0) throw("Can't rename checkpoint file");
+        return true;
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s %s\n", err, tmp.c_str());
+        ofs.close();
+        return false;
+    }
+}
+
+CheckpointStatus VarianceBuffer::Load (std::string filename, CheckpointInfo const& info, int *progress) {
+    std::ifstream ifs;
+    ifs.open(filename, std::ios::binary);
+    if (ifs.fail()) return CHECKPOINT_NONE;   // no checkpoint yet
+    try {
+        char magic[sizeof(CheckpointMagic)];
+        char sampler[SamplerNameSize];
+        int w, h, p, spp;
+        unsigned int seed;
+        uint64_t sceneHash;
+        ifs.read(magic, sizeof(magic));
+        read(ifs, w);
+        read(ifs, h);
+        read(ifs, p);
+        read(ifs, seed);
+        read(ifs, spp);
+        ifs.read(sampler, sizeof(sampler));
+        read(ifs, sceneHash);
+        if (ifs.fail() || memcmp(magic, CheckpointMagic, sizeof(magic)) != 0) throw("Not a checkpoint file");
+        sampler[SamplerNameSize - 1] = 0;
+        if (w != W || h != H) throw("Checkpoint resolution does not match");
+        if (seed != info.seed) throw("Checkpoint seed does not match");
+        if (spp != info.spp) throw("Checkpoint spp does not match");
+        if (info.sampler.compare(0, SamplerNameSize - 1, sampler) != 0) throw("Checkpoint sampler does not match");
+        if (sceneHash != info.sceneHash) throw("Checkpoint scene or camera does not match");
+
+        std::vector<PixelStats> loaded(W*H);
+        for (PixelStats& ps : loaded) {
+            read(ifs, ps.n);
+            read(ifs, ps.sum.R);
+            read(ifs, ps.sum.G);
+            read(ifs, ps.sum.B);
+            read(ifs, ps.meanY);
+            read(ifs, ps.M2);
+        }
+        if (ifs.fail()) throw("Truncated checkpoint file");
+        stats.swap(loaded);
+        *progress = p;
+        ifs.close();
+        return CHECKPOINT_LOADED;
+    }
+    catch (const char *err) {
+        fprintf(stderr, "%s: %s\n", filename.c_str(), err);
+        ifs.close();
+        return CHECKPOINT_INVALID;
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  VarianceBuffer.hpp
+//  VI-RT
+//
+//  Per pixel running statistics of the samples, kept next to an Image's
+//  imagePlane: number of samples, their sum and the running mean and sum of
+//  squared deviations of their luminance, updated one sample at a time with
+//  Welford's algorithm (numerically stable and no need to keep the samples)
+//
+
+#ifndef VarianceBuffer_hpp
+#define VarianceBuffer_hpp
+
+#include "RGB.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <math.h>
+
+typedef struct PixelStats {
+    int n;          // number of samples
+    RGB sum;        // of the samples' radiance
+    float meanY;    // running mean of the luminance
+    float M2;       // sum of squared deviations of the luminance from meanY
+
+    PixelStats(): n(0), sum(0., 0., 0.), meanY(0.f), M2(0.f) {}
+
+    void Add (RGB const& L) {
+        float const y = L.Y();
+        float const delta = y - meanY;
+        n++;
+        sum += L;
+        meanY += delta / n;
+        M2 += delta * (y - meanY);
+    }
+    RGB Mean () {
+        return (n > 0) ? sum / (float)n : RGB(0., 0., 0.);
+    }
+    // unbiased sample variance of the luminance
+    float Variance () const {
+        return (n > 1) ? M2 / (n - 1) : 0.f;
+    }
+    // standard error of the mean luminance relative to it
+    // (floor : luminance below which the absolute error is used instead)
+    float RelativeError (float const floor = 1.e-3f) const {
+        if (n < 2) return INFINITY;
+        return sqrtf(Variance() / n) / fmaxf(meanY, floor);
+    }
+} PixelStats;
+
+// what a checkpoint's samples depend on, besides the resolution: a checkpoint is
+// only resumed by a render with the same parameters
+typedef struct CheckpointInfo {
+    unsigned int seed;      // of the sampler
+    int spp;                // target samples per pixel
+    std::string sampler;    // sampler type and parameters (Sampler::Name)
+    uint64_t sceneHash;     // of the scene and camera
+} CheckpointInfo;
+
+enum CheckpointStatus {
+    CHECKPOINT_NONE,        // no checkpoint file
+    CHECKPOINT_LOADED,
+    CHECKPOINT_INVALID      // not a checkpoint, truncated or for another render
+};
+
+class VarianceBuffer {
+    std::vector<PixelStats> stats;
+public:
+    int W, H;
+    VarianceBuffer (int const W, int const H): stats(W*H), W(W), H(H) {}
+
+    PixelStats& get (int const x, int const y) { return stats[y*W+x]; }
+    void clear () { stats.assign(W*H, PixelStats()); }
+
+    // checkpoints: the statistics (accumulated radiance and sample counts) of all pixels,
+    // a caller defined progress counter (e.g., number of passes) and the render's CheckpointInfo
+    // Save writes to filename.tmp, flushes it to disk and then renames it, so that a job
+    // killed (or a machine crashing) while saving leaves the previous checkpoint intact
+    bool Save (std::string filename, int const progress, CheckpointInfo const& info);
+    // the buffer is only changed if CHECKPOINT_LOADED : a WxH checkpoint with the same info
+    CheckpointStatus Load (std::string filename, CheckpointInfo const& info, int *progress);
+};
+
+#endif /* VarianceBuffer_hpp */
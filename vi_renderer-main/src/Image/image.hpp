@@ -16,6 +16,9 @@ typedef struct {
     unsigned char val[3];  // r,g,b
 } char_pixel;
 
+// so that an imagePlane can be read / written as 3*W*H floats
+static_assert(sizeof(RGB) == 3 * sizeof(float), "RGB must be 3 packed floats");
+
 class Image {
 protected:
     RGB *imagePlane;
@@ -49,6 +52,8 @@ public:
         imagePlane[y*W+x] /= alpha;
         return true;
     }
+    // the pixels, row by row from the top (W*H RGB)
+    RGB const* Pixels () const { return imagePlane; }
     virtual bool Save (std::string filename) {return true;}
     virtual bool Load (std::string filename) {return true;}
     
@@ -42,9 +42,15 @@ public:
     }
     // return a point p, RGB radiance and pdf given a pair of random number in [0..[
     RGB Sample_L (float *r, Point *p, float& _pdf) {
-        intensity = Sample_L (r, p);
         _pdf = pdf;
-        return intensity;
+        return Sample_L (r, p);
+    }
+    // solid angle pdf of the point found at distance along the (unit) direction wi
+    // when sampling uniformly over the area; zero if it is seen from behind the emitter
+    float pdf_SolidAngle (Vector const& wi, float const distance) {
+        float const cosL = -1.f * wi.dot(gem->normal);
+        if (cosL <= 1.e-4f) return 0.f;
+        return pdf * distance * distance / cosL;
     }
 };
 
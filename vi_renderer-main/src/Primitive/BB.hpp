@@ -35,7 +35,7 @@ public:
 
 #define BB_TEST
 #ifdef BB_TEST
-    bool intersect (Ray r) {
+    bool intersect (const Ray& r) {
         float t0 = 0.f, t1 = MAXFLOAT;
         float invRayDir, tNear, tFar;
         // XX slabs
@@ -89,7 +89,7 @@ public:
         return true;
     }
 #else
-    bool intersect (Ray r) {
+    bool intersect (const Ray& r) {
         return true;
     }
 #endif
@@ -10,6 +10,7 @@
 
 #include "vector.hpp"
 #include "RGB.hpp"
+#include <math.h>
 
 typedef enum {
     SPECULAR_REF=1,
@@ -32,7 +33,18 @@ public:
     // return an outgoing direction wo and brdf RGB value for a given wi and probability pair prob[2]
     virtual RGB Sample_f (Vector wi, float *prob, Vector *wo, const BRDF_TYPES = BRDF_ALL) {return RGB();}
     // return the probability of sampling wo given wi
-    virtual float pdf(Vector wi, Vector wo, const BRDF_TYPES = BRDF_ALL) {return 0.;}
+    // both directions in the shading frame (Z = normal); each lobe of type is selected with
+    // probability proportional to its luminance (as PathTracing::Scatter does) and the
+    // diffuse lobe is cosine sampled; the specular lobes are deltas, they contribute nothing
+    virtual float pdf(Vector wi, Vector wo, const BRDF_TYPES type = BRDF_ALL) {
+        if (!(type & DIFFUSE_REF) || wi.Z <= 0.f || wo.Z <= 0.f) return 0.;
+        float const kd = Kd.Y();
+        float sum = kd;
+        if (type & SPECULAR_REF) sum += Ks.Y();
+        if (type & SPECULAR_TRANS) sum += Kt.Y();
+        if (sum <= 0.f) return 0.;
+        return (kd / sum) * wo.Z / (float)M_PI;
+    }
 };
 
 #endif /* BRDF_hpp */
@@ -9,12 +9,12 @@
 #define DiffuseTexture_hpp
 
 #include "BRDF.hpp"
-#include "ImagePPM.hpp"
+#include "Texture8.hpp"
 #include "Triangle.hpp"
 
 class DiffuseTexture: public BRDF {
 private:
-    ImagePPM texture;
+    Texture8 texture;   // 8 bits per component, converted on lookup
     float tex_W, tex_H;
 public:
     DiffuseTexture(std::string filename) {
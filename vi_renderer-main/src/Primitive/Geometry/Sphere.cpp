@@ -8,13 +8,10 @@
 #include <stdio.h>
 #include "Sphere.hpp"
 
-bool Sphere::intersect(Ray r, Intersection *isect) {
-    
-    if (!bb.intersect(r)) {
-        return false;
-    }
+bool Sphere::intersectT(const Ray& r, float *t, float *u, float *v) {
     
     // from https://raytracing.github.io/books/RayTracingInOneWeekend.html#surfacenormalsandmultipleobjects/simplifyingtheray-sphereintersectioncode
+    // (the BVH has already tested the sphere's bounding box)
     Vector oc = r.o.vec2point(C);
     //float a = r.dir.normSQ();
     //float a = 1.f;   // ray direction is normalized
@@ -26,34 +23,29 @@ bool Sphere::intersect(Ray r, Intersection *isect) {
     }
     
     // intersection distance along ray
-    float t = h - std::sqrt(discriminant);
+    *t = h - std::sqrt(discriminant);
+    // no surface parametrization
+    *u = *v = 0.f;
     
-    if (t > EPSILON) // ray intersection
-    {
-        Point pHit = r.o + t* r.dir;
-        Vector normal = C.vec2point(pHit);
-        normal.normalize();
-        
-        // Fill Intersection data from triangle hit : pag 165
-        Vector wo = -1.f * r.dir;
-        // make sure the normal points to the same side of the surface as wo
-        Vector const for_normal = normal.Faceforward(wo);
-        isect->p = pHit;
-        isect->gn = for_normal;
-        isect->sn = for_normal;
-        isect->wo = wo;
-        isect->depth = t;
-        isect->FaceID = -1;
-        isect->pix_x = r.pix_x;
-        isect->pix_y = r.pix_y;
-        isect->incident_eta = r.propagating_eta;
-        
-        return true;
-    }
-    else  {// This means that there is a line intersection but not a ray intersection.
-        return false;
-    }
+    return (*t > r.tMin && *t < r.tMax); // ray intersection
+}
+
+void Sphere::computeSurfaceInteraction(const Ray& r, float const t, float const u, float const v, Intersection *isect) {
+    Point pHit = r.o + t* r.dir;
+    Vector normal = C.vec2point(pHit);
+    normal.normalize();
     
-    return false;
+    // Fill Intersection data from triangle hit : pag 165
+    Vector wo = -1.f * r.dir;
+    // make sure the normal points to the same side of the surface as wo
+    Vector const for_normal = normal.Faceforward(wo);
+    isect->p = pHit;
+    isect->gn = for_normal;
+    isect->sn = for_normal;
+    isect->wo = wo;
+    isect->depth = t;
+    isect->FaceID = -1;
+    isect->pix_x = r.pix_x;
+    isect->pix_y = r.pix_y;
+    isect->incident_eta = r.propagating_eta;
 }
- 
@@ -19,7 +19,8 @@ public:
     float radiusSq;
    // BB bb;      // sphere bounding box
                 // this is min={0.,0.,0.} , max={0.,0.,0.} due to the Point constructor
-    bool intersect (Ray r, Intersection *isect);
+    bool intersectT (const Ray& r, float *t, float *u, float *v);
+    void computeSurfaceInteraction (const Ray& r, float const t, float const u, float const v, Intersection *isect);
     
     Sphere(Point _C, float _r): C(_C), radius(_r) {
         radiusSq = radius * radius;
@@ -17,7 +17,18 @@ class Geometry {
 public:
     Geometry () {}
     ~Geometry () {}
-    virtual bool intersect (Ray r, Intersection *isect) { return false; }
+    virtual bool intersectT (const Ray& r, float *t, float *u, float *v) { return false; }
+    // return True if r intersects this geometric primitive at a distance r.tMin < t < r.tMax
+    // only t and the surface parameters (u,v) of the hit are computed
+    virtual void computeSurfaceInteraction (const Ray& r, float const t, float const u, float const v, Intersection *isect) {}
+    // fill isect for a hit previously found by intersectT
+    // (the BVH calls it once per ray, for the closest hit only)
+    bool intersect (const Ray& r, Intersection *isect) {
+        float t, u, v;
+        if (!intersectT(r, &t, &u, &v)) return false;
+        computeSurfaceInteraction(r, t, u, v, isect);
+        return true;
+    }
     // return True if r intersects this geometric primitive
     // returns data about intersection on isect
     virtual BB WorldBound() const { return bb; }
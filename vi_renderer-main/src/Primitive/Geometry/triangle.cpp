@@ -9,40 +9,6 @@
 #include "BB.hpp"
 
 
-// Function to compute barycentric coordinates
-Vector Triangle::computeBarycentrics (Point p) {
-    Vector bary;
-        //v0v1 = edge1
-        //v0v2 = edge2
-    Vector v1p  = v1.vec2point (p);
-    
-    float areaABC = area(); // Triangle area
-
-    // Compute lambda1
-    Vector v2p  = v2.vec2point(p);
-    Vector n1 = { edge3.Y * v2p.Z - edge3.Z * v2p.Y,
-        edge3.Z * v2p.X - edge3.X * v2p.Z,
-        edge3.X * v2p.Y - edge3.Y * v2p.X };
-
-    float areaPBC = n1.norm() / 2.0f;
-    bary.X = areaPBC / areaABC;
-
-    // Compute lambda2
-    Vector v3v1 = -1.f * edge2;
-    Vector v3p  = v3.vec2point(p);
-    Vector n2 = { v3v1.Y * v3p.Z - v3v1.Z * v3p.Y,
-        v3v1.Z * v3p.X - v3v1.X * v3p.Z,
-        v3v1.X * v3p.Y - v3v1.Y * v3p.X };
-
-    float areaPCA = n2.norm() / 2.0f;
-    bary.Y = areaPCA / areaABC;
-
-    // Compute lambda3
-    bary.Z = 1.0f - bary.X - bary.Y;
-    
-    return bary;
-}
-
 // Function to map texture coordinates using barycentric coordinates
 Vec2 Triangle::interpolateTexture(Vector baryCoord) {
     Vec2 uv;
@@ -50,13 +16,30 @@ Vec2 Triangle::interpolateTexture(Vector baryCoord) {
     uv.v = baryCoord.X * uv1.v + baryCoord.Y * uv2.v + baryCoord.Z * uv3.v;
     return uv;
 }
+void Triangle::computeSurfaceInteraction (const Ray& r, float const t, float const u, float const v, Intersection *isect) {
+    Point pHit = r.o + t* r.dir;
+    
+    // Fill Intersection data from triangle hit : pag 165
+    Vector wo = -1.f * r.dir;
+    // make sure the normal points to the same side of the surface as wo
+    Vector const for_normal = normal.Faceforward(wo);
+    isect->p = pHit;
+    isect->gn = for_normal;
+    isect->sn = for_normal;
+    isect->wo = wo;
+    isect->depth = t;
+    isect->FaceID = -1;
+    isect->pix_x = r.pix_x;
+    isect->pix_y = r.pix_y;
+    isect->incident_eta = r.propagating_eta;
+    
+    // (u,v) are the barycentric weights of v2 and v3
+    isect->TexCoord = interpolateTexture(Vector(1.f - u - v, u, v));
+}
+
 // https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
 // Moller Trumbore intersection algorithm
-bool Triangle::intersect(Ray r, Intersection *isect) {
-
-    if (!bb.intersect(r)) {
-        return false;
-    }
+bool Triangle::intersectT(const Ray& r, float *t, float *u, float *v) {
 
     // Check whether the ray is parallel to the plan containing the triangle
     // The dot ptoduct between the ray direction and the triangle normal will be 0
@@ -70,51 +53,29 @@ bool Triangle::intersect(Ray r, Intersection *isect) {
     // r.o - v0 = t * r.dir + u (v1-v0) + v (v2-v0)
     // there are 3 unknowns (t,u,v)
     // and 3 equations (for XX, YY, ZZ)
+    // (single precision: the BVH leaves use the same computation, 4 triangles at a time)
     
-    Vector h, s, q;
-    float a,ff,u,v;
-
-    h = r.dir.cross(edge2);
-    a = edge1.dot(h);
-    ff = 1.0/a;
-    s = v1.vec2point(r.o);
-    u = ff * s.dot(h);
-    if (u < 0.0 || u > 1.0) {
+    const Vector h(r.dir.Y * edge2.Z - r.dir.Z * edge2.Y,
+                   r.dir.Z * edge2.X - r.dir.X * edge2.Z,
+                   r.dir.X * edge2.Y - r.dir.Y * edge2.X);
+    const float a = edge1.dot(h);
+    const float ff = 1.f/a;
+    const Vector s(r.o.X - v1.X, r.o.Y - v1.Y, r.o.Z - v1.Z);
+    *u = ff * s.dot(h);
+    if (*u < 0.f || *u > 1.f) {
         return false;
     }
-    q = s.cross(edge1);
-    v = ff * r.dir.dot(q);
-    if (v < 0.0 || u + v > 1.0) {
+    const Vector q(s.Y * edge1.Z - s.Z * edge1.Y,
+                   s.Z * edge1.X - s.X * edge1.Z,
+                   s.X * edge1.Y - s.Y * edge1.X);
+    *v = ff * r.dir.dot(q);
+    if (*v < 0.f || *u + *v > 1.f) {
         return false;
     }
     // At this stage we can compute t to find out where the intersection point is on the line.
-    float t = ff * edge2.dot(q);
-    if (t > EPSILON) // ray intersection
-    {
-        Point pHit = r.o + t* r.dir;
-        
-        // Fill Intersection data from triangle hit : pag 165
-        Vector wo = -1. * r.dir;
-        // make sure the normal points to the same side of the surface as wo
-        Vector const for_normal = normal.Faceforward(wo);
-        isect->p = pHit;
-        isect->gn = for_normal;
-        isect->sn = for_normal;
-        isect->wo = wo;
-        isect->depth = t;
-        isect->FaceID = -1;
-        isect->pix_x = r.pix_x;
-        isect->pix_y = r.pix_y;
-        isect->incident_eta = r.propagating_eta;
-        
-        Vector baryCoord = computeBarycentrics(pHit);
-        isect->TexCoord = interpolateTexture(baryCoord);
-
-        return true;
-    }
-    else  {// This means that there is a line intersection but not a ray intersection.
-        return false;
-    }
+    // the surface interaction is only computed later, if this turns out to be the closest hit
+    *t = ff * edge2.dot(q);
+    return (*t > r.tMin && *t < r.tMax); // ray intersection
 }
 
 bool Triangle::isInside(Point p) {
@@ -13,7 +13,6 @@
 #include <math.h>
 
 class Triangle: public Geometry {
-    Vector computeBarycentrics (Point p);
     Vec2 interpolateTexture(Vector baryCoord);
 public:
     bool BackFaceCulling;
@@ -23,7 +22,9 @@ public:
     Vector edge1, edge2, edge3;
     //BB bb;      // face bounding box
                 // this is min={0.,0.,0.} , max={0.,0.,0.} due to the Point constructor
-    bool intersect (Ray r, Intersection *isect);
+    // (u,v) are the Moller-Trumbore coordinates : barycentrics are (1-u-v, u, v) for (v1, v2, v3)
+    bool intersectT (const Ray& r, float *t, float *u, float *v);
+    void computeSurfaceInteraction (const Ray& r, float const t, float const u, float const v, Intersection *isect);
     bool isInside(Point p);
     
     Triangle(Point _v1, Point _v2, Point _v3, Vector _normal, bool backface=true): v1(_v1), v2(_v2), v3(_v3), normal(_normal) {
@@ -14,6 +14,7 @@
 typedef struct Primitive {
     Geometry *g;
     int material_ndx;
+    int light_ndx = -1;   // emitters in the scene BVH : index in Scene::lights ; -1 otherwise
 } Primitive;
 
 #endif /* primitive_hpp */
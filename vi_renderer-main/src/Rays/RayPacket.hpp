@@ -0,0 +1,60 @@
+//
+//  RayPacket.hpp
+//  VI-RT
+//
+//  A packet of up to 4 coherent rays (e.g., the samples of one pixel)
+//  traced together through the BVH: each box is tested against all rays
+//  with one SIMD slab test
+//
+
+#ifndef RayPacket_hpp
+#define RayPacket_hpp
+
+#include "ray.hpp"
+#include <algorithm>
+
+class RayPacket {
+public:
+    static const int SIZE = 4;
+    Ray rays[SIZE];
+    int n;    // number of valid rays
+
+    // SoA copies of the rays' origin and direction reciprocal, for SIMD box tests
+    float o[3][SIZE];
+    float invDir[3][SIZE];
+
+    // Interval arithmetic bounds of the packet (frustum culling)
+    // valid only if all rays have the same direction signs (coherent == true)
+    bool coherent;
+    float oMin[3], oMax[3];
+    float invMin[3], invMax[3];
+    int dirIsNeg[3];
+
+    RayPacket (): n(0), coherent(false) {}
+
+    // compute the SoA arrays and the packet bounds; call after filling rays[0..n[
+    void Setup (void) {
+        for (int i = 0; i < SIZE; i++) {
+            // unused lanes replicate ray 0, so their tests are well defined
+            const Ray &r = rays[i < n ? i : 0];
+            const float d[3] = {r.dir.X, r.dir.Y, r.dir.Z};
+            o[0][i] = r.o.X; o[1][i] = r.o.Y; o[2][i] = r.o.Z;
+            for (int a = 0; a < 3; a++) invDir[a][i] = 1.f / d[a];
+        }
+        coherent = (n > 0);
+        for (int a = 0; a < 3; a++) {
+            dirIsNeg[a] = invDir[a][0] < 0;
+            oMin[a] = oMax[a] = o[a][0];
+            invMin[a] = invMax[a] = invDir[a][0];
+            for (int i = 1; i < n; i++) {
+                if ((invDir[a][i] < 0) != dirIsNeg[a]) coherent = false;
+                oMin[a] = std::min(oMin[a], o[a][i]);
+                oMax[a] = std::max(oMax[a], o[a][i]);
+                invMin[a] = std::min(invMin[a], invDir[a][i]);
+                invMax[a] = std::max(invMax[a], invDir[a][i]);
+            }
+        }
+    }
+};
+
+#endif /* RayPacket_hpp */
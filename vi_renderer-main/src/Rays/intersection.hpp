@@ -25,6 +25,7 @@ public:
     int FaceID;  // ID of the intersected face 
     bool isLight;  // for intersections with light sources
     RGB Le;         // for intersections with light sources
+    int light_ndx;  // for intersections with light sources : index in Scene::lights
     float incident_eta;
     Vec2 TexCoord;    
     
@@ -29,6 +29,9 @@ public:
     RGB throughput;
     int pix_x, pix_y;
     float propagating_eta;
+    // valid interval along the ray: intersections are only reported for tMin < t < tMax
+    // intersection routines shrink tMax as closer hits are found
+    float tMin = EPSILON, tMax = MAXFLOAT;
     Ray () {}
     Ray (Point o, Vector d, RayType t, RGB _throughput): o(o),dir(d), rtype(t), throughput(_throughput) {
         //invertDir();
@@ -0,0 +1,109 @@
+//
+//  AdaptiveRenderer.cpp
+//  VI-RT
+//
+
+#include "AdaptiveRenderer.hpp"
+#include <algorithm>
+#include <math.h>
+
+void AdaptiveRenderer::EstimateError () {
+    int const W = stats.W, H = stats.H;
+    std::vector<float> own(W * H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            own[y * W + x] = stats.get(x, y).RelativeError();
+        }
+    }
+    error.resize(W * H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float e = 0.f;
+            for (int yy = std::max(y - 1, 0); yy <= std::min(y + 1, H - 1); yy++) {
+                for (int xx = std::max(x - 1, 0); xx <= std::min(x + 1, W - 1); xx++) {
+                    e = fmaxf(e, own[yy * W + xx]);
+                }
+            }
+            error[y * W + x] = e;
+        }
+    }
+}
+
+int AdaptiveRenderer::SamplesNeeded (PixelStats const& ps, float const err) const {
+    if (ps.n == 0) return std::min(minSpp, maxSpp);   // first pass
+    if (ps.n >= maxSpp) return 0;
+    if (err <= maxError) return 0;
+
+    // the error decreases with 1/sqrt(n): the pixel needs about n (err/maxError)^2 samples;
+    // as the variance estimate is itself noisy, at most double the samples in each pass
+    // (and at least minSpp, not to spend many passes on pixels close to the target)
+    float const ratio = err / maxError;
+    float const needed = fminf(ps.n * ratio * ratio, 2.f * ps.n);
+    int const more = std::max((int)ceilf(needed) - ps.n, minSpp);
+    return std::min(more, maxSpp - ps.n);
+}
+
+bool AdaptiveRenderer::OutOfTime () const {
+    if (timeBudget <= 0.) return false;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= timeBudget;
+}
+
+void AdaptiveRenderer::RenderTile (Tile const& t, Sampler *smp) {
+    long samples = 0;
+    for (int y = t.y0; y < t.y1; y++) {
+        for (int x = t.x0; x < t.x1; x++) {
+            PixelStats &ps = stats.get(x, y);
+            int const more = SamplesNeeded(ps, (pass > 0) ? error[y * stats.W + x] : 0.f);
+            if (more <= 0) continue;
+
+            RenderSamples(x, y, ps.n, ps.n + more, smp, ps);
+            samples += more;
+            img->set(x, y, ps.Mean());
+        }
+    }
+    passSamples += samples;
+}
+
+void AdaptiveRenderer::Render() {
+    int W = 0, H = 0;
+
+    // Get resolution from camera
+    cam->getResolution(&W, &H);
+
+    // a new frame for the per pixel light reservoirs (if any)
+    if (scene->reservoirs) scene->reservoirs->NextFrame();
+
+    int const threads = MakeTiles(W, H);
+
+    fprintf(stdout, "Adaptive rendering %d tiles (%dx%d) with %d threads : %d to %d spp, error %g",
+            (int)tiles.size(), tileSize, tileSize, threads, minSpp, maxSpp, maxError);
+    if (timeBudget > 0.) fprintf(stdout, ", %g s", timeBudget);
+    fprintf(stdout, "\n");
+
+    stats.clear();
+    start = std::chrono::steady_clock::now();
+    long total = 0;
+
+    for (pass = 0 ; ; pass++) {
+        passSamples = 0;
+        if (pass > 0) EstimateError();
+
+        // the first pass is always completed, so that every pixel has its minSpp samples
+        RunTiles(threads, [this](int, Tile const& t, Sampler *smp) { RenderTile(t, smp); },
+                 [this]() { return pass > 0 && OutOfTime(); });
+
+        long const samples = passSamples;
+        total += samples;
+        fprintf(stderr, "pass %d : %ld samples\r", pass, samples);
+        if (samples == 0 || OutOfTime()) break;
+    }
+
+    EstimateError();
+    int converged = 0;
+    for (int i = 0; i < W * H; i++) {
+        if (error[i] <= maxError) converged++;
+    }
+    fprintf(stderr, "\n");
+    fprintf(stdout, "%d passes, %.1f spp on average, %.1f%% of the pixels within the error\n",
+            pass + 1, (double)total / (W * H), 100. * converged / (W * H));
+}
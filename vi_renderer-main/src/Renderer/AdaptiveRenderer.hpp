@@ -0,0 +1,59 @@
+//
+//  AdaptiveRenderer.hpp
+//  VI-RT
+//
+//  Adaptive sampling: instead of spp samples everywhere, every pixel gets
+//  minSpp samples and then, pass after pass, more samples go only to the
+//  pixels whose estimated error (standard error of the mean luminance
+//  relative to it, see VarianceBuffer) is above maxError. A few samples may
+//  all agree by chance (e.g., all miss a small light), so the error of a pixel
+//  is taken as the largest among its 3x3 neighbourhood.
+//  A pixel gets at least minSpp and at most as many new samples in a pass as it
+//  already has, aiming at the number its variance says it needs, and never more
+//  than maxSpp in total.
+//  Rendering stops when all pixels reach maxError (or maxSpp) or when the
+//  time budget is exhausted. The image holds the mean of each pixel's samples.
+//  Every pass is split into tiles, distributed among a pool of worker threads
+//  (see ParallelRenderer).
+//
+
+#ifndef AdaptiveRenderer_hpp
+#define AdaptiveRenderer_hpp
+
+#include "ParallelRenderer.hpp"
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+class AdaptiveRenderer: public ParallelRenderer {
+private:
+    int minSpp, maxSpp;
+    float maxError;     // target relative error
+    double timeBudget;  // seconds, 0 = unlimited
+
+    std::vector<float> error;        // per pixel error estimate for the current pass
+    int pass;
+    std::atomic<long> passSamples;   // samples taken in the current pass
+    std::chrono::steady_clock::time_point start;
+
+    // estimate the error of every pixel from the statistics of its neighbourhood
+    void EstimateError ();
+    // new samples for a pixel in this pass (0 once converged)
+    int SamplesNeeded (PixelStats const& ps, float const err) const;
+    bool OutOfTime () const;
+    void RenderTile (Tile const& t, Sampler *smp);
+
+public:
+    VarianceBuffer stats;   // per pixel sample statistics of the last Render()
+
+    AdaptiveRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd,
+                     int _minSpp, int _maxSpp, float _maxError, double _timeBudget, bool _jitter,
+                     int _nThreads=0, int _tileSize=16, unsigned int _seed=0, Sampler *_sampler=NULL):
+        ParallelRenderer(cam, scene, img, shd, _maxSpp, _jitter, _nThreads, _tileSize, _seed, _sampler),
+        minSpp(_minSpp < 2 ? 2 : _minSpp), maxSpp(_maxSpp), maxError(_maxError), timeBudget(_timeBudget),
+        pass(0), passSamples(0), stats(img->W, img->H) {}
+
+    void Render();
+};
+
+#endif /* AdaptiveRenderer_hpp */
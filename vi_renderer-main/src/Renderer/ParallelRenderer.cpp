@@ -0,0 +1,122 @@
+//
+//  ParallelRenderer.cpp
+//  VI-RT
+//
+
+#include "ParallelRenderer.hpp"
+#include <thread>
+#include <algorithm>
+
+int ParallelRenderer::MakeTiles (int const W, int const H) {
+    int threads = nThreads;
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+
+    tiles.clear();
+    for (int y = 0; y < H; y += tileSize) {
+        for (int x = 0; x < W; x += tileSize) {
+            Tile t = {x, y, std::min(x + tileSize, W), std::min(y + tileSize, H)};
+            tiles.push_back(t);
+        }
+    }
+    return std::min(threads, std::max((int)tiles.size(), 1));
+}
+
+// get the next tile for this worker: first from its own queue (back),
+// else steal from the other workers' queues (front)
+bool ParallelRenderer::NextTile (int const worker, int *tile) {
+    {
+        TileQueue &own = queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tiles.empty()) {
+            *tile = own.tiles.back();
+            own.tiles.pop_back();
+            return true;
+        }
+    }
+    int const nQueues = (int)queues.size();
+    for (int i = 1; i < nQueues; i++) {
+        TileQueue &victim = queues[(worker + i) % nQueues];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tiles.empty()) {
+            *tile = victim.tiles.front();
+            victim.tiles.pop_front();
+            return true;
+        }
+    }
+    // no tiles are ever added while the workers run, so all queues are empty : done
+    return false;
+}
+
+void ParallelRenderer::RunTiles (int const threads, std::function<void(int, Tile const&, Sampler *)> const& render,
+                                 std::function<bool()> const& stop, bool const progress) {
+    int const nTiles = (int)tiles.size();
+
+    // initial distribution: each worker gets a contiguous band of tiles,
+    // load imbalance among bands is then corrected by stealing
+    std::vector<TileQueue> q(threads);
+    queues.swap(q);
+    for (int i = 0; i < nTiles; i++) {
+        queues[(int)((long)i * threads / nTiles)].tiles.push_back(i);
+    }
+    tilesDone = 0;
+
+    auto worker = [&](int const w) {
+        int tile;
+        Sampler *smp = sampler->Clone();
+
+        while (NextTile(w, &tile)) {
+            if (stop && stop()) break;
+            render(w, tiles[tile], smp);
+            int const done = ++tilesDone;
+            if (progress && (done % 16 == 0 || done == nTiles)) {
+                fprintf(stderr, "%d/%d tiles\r", done, nTiles);
+            }
+        }
+        delete smp;
+    };
+
+    // the calling thread is worker 0
+    std::vector<std::thread> pool;
+    for (int w = 1; w < threads; w++) {
+        pool.push_back(std::thread(worker, w));
+    }
+    worker(0);
+    for (auto &t : pool) t.join();
+}
+
+void ParallelRenderer::RenderSamples (int const x, int const y, int const s0, int const s1, Sampler *smp, PixelStats& ps) {
+    for (int s = s0; s < s1; s += RayPacket::SIZE) {
+        RGB L[RayPacket::SIZE];
+        int const n = std::min(RayPacket::SIZE, s1 - s);
+
+        RenderPacket(x, y, s, n, smp, L);
+        for (int i = 0; i < n; i++) ps.Add(L[i]);
+    }
+}
+
+void ParallelRenderer::RenderTile (Tile const& t, Sampler *smp) {
+    for (int y = t.y0; y < t.y1; y++) {
+        for (int x = t.x0; x < t.x1; x++) {
+            img->set(x, y, RenderPixel(x, y, smp));
+        }
+    }
+}
+
+void ParallelRenderer::Render() {
+    int W = 0, H = 0;
+
+    // Get resolution from camera
+    cam->getResolution(&W, &H);
+
+    // a new frame for the per pixel light reservoirs (if any)
+    if (scene->reservoirs) scene->reservoirs->NextFrame();
+
+    int const threads = MakeTiles(W, H);
+    fprintf(stdout, "Rendering %d tiles (%dx%d) with %d threads\n", (int)tiles.size(), tileSize, tileSize, threads);
+
+    RunTiles(threads, [this](int, Tile const& t, Sampler *smp) { RenderTile(t, smp); },
+             std::function<bool()>(), true);
+
+    fprintf(stderr, "\n");
+}
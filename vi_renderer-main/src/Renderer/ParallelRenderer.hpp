@@ -0,0 +1,70 @@
+//
+//  ParallelRenderer.hpp
+//  VI-RT
+//
+//  Multithreaded version of the StandardRenderer
+//  The image is split into square tiles which are distributed among a pool of
+//  worker threads. Each worker owns a deque of tiles; when its deque runs dry
+//  it steals tiles from the other workers, so that threads that got cheap tiles
+//  (e.g., background) help those that got expensive ones.
+//  The tiling and the scheduler are shared with the renderers built on this one
+//  (AdaptiveRenderer, ProgressiveRenderer, WavefrontRenderer).
+//
+
+#ifndef ParallelRenderer_hpp
+#define ParallelRenderer_hpp
+
+#include "StandardRenderer.hpp"
+#include "VarianceBuffer.hpp"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+class ParallelRenderer: public StandardRenderer {
+protected:
+    int nThreads;   // 0 = std::thread::hardware_concurrency()
+    int tileSize;   // tile side, in pixels
+
+    typedef struct {
+        int x0, y0, x1, y1;   // [x0,x1[ x [y0,y1[
+    } Tile;
+
+    std::vector<Tile> tiles;
+
+    // split the W x H image into tiles; returns the number of worker threads to use
+    // (nThreads, but no more than tiles)
+    int MakeTiles (int const W, int const H);
+    // render(worker, tile, smp) for every tile, on 'threads' workers (the calling thread is
+    // worker 0), each with its own Clone() of the sampler
+    // stop (optional) is checked before each tile: once it returns true the workers quit,
+    // leaving the remaining tiles undone ; progress: report the number of tiles done
+    void RunTiles (int const threads, std::function<void(int, Tile const&, Sampler *)> const& render,
+                   std::function<bool()> const& stop = std::function<bool()>(), bool const progress = false);
+    // samples [s0, s1[ of pixel (x,y), in packets of (up to) RayPacket::SIZE, added to ps
+    void RenderSamples (int const x, int const y, int const s0, int const s1, Sampler *smp, PixelStats& ps);
+
+private:
+    // per worker tile queue: the owner pops from the back, thieves steal from the front
+    typedef struct {
+        std::mutex lock;
+        std::deque<int> tiles;   // indices into the tiles vector
+    } TileQueue;
+
+    std::vector<TileQueue> queues;
+    std::atomic<int> tilesDone;
+
+    bool NextTile (int const worker, int *tile);
+    void RenderTile (Tile const& t, Sampler *smp);
+
+public:
+    ParallelRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd, int _spp, bool _jitter,
+                     int _nThreads=0, int _tileSize=16, unsigned int _seed=0, Sampler *_sampler=NULL):
+        StandardRenderer(cam, scene, img, shd, _spp, _jitter, _seed, _sampler),
+        nThreads(_nThreads), tileSize(_tileSize), tilesDone(0) {}
+
+    void Render();
+};
+
+#endif /* ParallelRenderer_hpp */
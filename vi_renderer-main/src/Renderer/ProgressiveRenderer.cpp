@@ -0,0 +1,144 @@
+//
+//  ProgressiveRenderer.cpp
+//  VI-RT
+//
+
+#include "ProgressiveRenderer.hpp"
+#include <algorithm>
+#include <cstring>
+
+double ProgressiveRenderer::Elapsed () const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t HashFloat (uint64_t const h, float const f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return MixBits(h ^ bits);
+}
+
+// Point or Vector
+template <typename T>
+static uint64_t HashXYZ (uint64_t h, T const& v) {
+    h = HashFloat(h, v.X);
+    h = HashFloat(h, v.Y);
+    return HashFloat(h, v.Z);
+}
+
+// the scene and camera are summarised by what a grid of rays through the pixel centres
+// sees: the rays themselves and the position, normal and material of their hits
+uint64_t ProgressiveRenderer::SceneHash (int const W, int const H) {
+    static const int Probes = 16;   // per image side
+    uint64_t h = MixBits(((uint64_t)scene->numPrimitives << 32) ^ ((uint64_t)scene->numLights << 16) ^ scene->numBRDFs);
+
+    for (int j = 0; j < Probes; j++) {
+        for (int i = 0; i < Probes; i++) {
+            int const x = (int)((i + 0.5f) * W / Probes), y = (int)((j + 0.5f) * H / Probes);
+            Ray r;
+            Intersection isect;
+
+            if (!cam->GenerateRay(x, y, &r)) continue;
+            h = HashXYZ(HashXYZ(h, r.o), r.dir);
+            if (!scene->trace(r, &isect)) continue;
+            h = HashXYZ(HashXYZ(h, isect.p), isect.gn);
+            if (isect.isLight) h = HashFloat(HashFloat(HashFloat(h, isect.Le.R), isect.Le.G), isect.Le.B);
+            else if (isect.f != NULL) h = HashFloat(HashFloat(HashFloat(h, isect.f->Kd.R), isect.f->Kd.G), isect.f->Kd.B);
+        }
+    }
+    return h;
+}
+
+void ProgressiveRenderer::RenderTile (Tile const& t, Sampler *smp) {
+    long samples = 0;
+    for (int y = t.y0; y < t.y1; y++) {
+        for (int x = t.x0; x < t.x1; x++) {
+            PixelStats &ps = accum.get(x, y);
+            int const more = (maxSpp > 0) ? std::min(passSpp, maxSpp - ps.n) : passSpp;
+            if (more <= 0) continue;
+
+            RenderSamples(x, y, ps.n, ps.n + more, smp, ps);
+            samples += more;
+            img->set(x, y, ps.Mean());
+        }
+    }
+    passSamples += samples;
+}
+
+void ProgressiveRenderer::Render() {
+    int W = 0, H = 0;
+
+    // Get resolution from camera
+    cam->getResolution(&W, &H);
+
+    if (maxSpp <= 0 && timeBudget <= 0.) {
+        fprintf(stderr, "ProgressiveRenderer: either maxSpp or a time budget must be set\n");
+        return;
+    }
+
+    int const threads = MakeTiles(W, H);
+
+    // resume from the checkpoint, if there is one ; one for a different render is never
+    // resumed nor overwritten
+    CheckpointInfo info;
+    info.seed = sampler->Seed();
+    info.spp = maxSpp;
+    info.sampler = sampler->Name();
+    info.sceneHash = SceneHash(W, H);
+
+    int pass = 0;
+    accum.clear();
+    CheckpointStatus const status = checkpoint.empty() ? CHECKPOINT_NONE : accum.Load(checkpoint, info, &pass);
+    if (status == CHECKPOINT_INVALID) {
+        fprintf(stderr, "ProgressiveRenderer: not resuming from %s (remove it or use another checkpoint file)\n", checkpoint.c_str());
+        return;
+    }
+    if (status == CHECKPOINT_LOADED) {
+        long done = 0;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                PixelStats &ps = accum.get(x, y);
+                done += ps.n;
+                img->set(x, y, ps.Mean());
+            }
+        }
+        fprintf(stdout, "Resuming from %s : %d passes, %.1f spp\n", checkpoint.c_str(), pass, (double)done / (W * H));
+    }
+
+    fprintf(stdout, "Progressive rendering %d tiles (%dx%d) with %d threads : %d spp per pass",
+            (int)tiles.size(), tileSize, tileSize, threads, passSpp);
+    if (maxSpp > 0) fprintf(stdout, ", up to %d spp", maxSpp);
+    if (timeBudget > 0.) fprintf(stdout, ", %g s", timeBudget);
+    fprintf(stdout, "\n");
+
+    start = std::chrono::steady_clock::now();
+    double lastCheckpoint = 0.;
+    long total = 0;
+
+    for ( ; ; pass++) {
+        passSamples = 0;
+
+        // a new frame for the per pixel light reservoirs (if any)
+        if (scene->reservoirs) scene->reservoirs->NextFrame();
+
+        RunTiles(threads, [this](int, Tile const& t, Sampler *smp) { RenderTile(t, smp); },
+                 [this]() { return timeBudget > 0. && Elapsed() >= timeBudget; });
+
+        long const samples = passSamples;
+        total += samples;
+        double const elapsed = Elapsed();
+        fprintf(stderr, "pass %d : %.1f spp total, %.1f s\r", pass, (double)total / (W * H), elapsed);
+
+        if (samples == 0 || (timeBudget > 0. && elapsed >= timeBudget)) {
+            if (samples > 0) pass++;
+            break;
+        }
+        if (!checkpoint.empty() && elapsed - lastCheckpoint >= checkpointInterval) {
+            accum.Save(checkpoint, pass + 1, info);
+            lastCheckpoint = elapsed;
+        }
+    }
+    if (!checkpoint.empty()) accum.Save(checkpoint, pass, info);
+
+    fprintf(stderr, "\n");
+    fprintf(stdout, "%d passes, %.1f spp added in %.1f s\n", pass, (double)total / (W * H), Elapsed());
+}
@@ -0,0 +1,62 @@
+//
+//  ProgressiveRenderer.hpp
+//  VI-RT
+//
+//  Progressive rendering: the image is refined by passes of passSpp samples
+//  per pixel, accumulated (in floating point, HDR) in a VarianceBuffer that
+//  also keeps each pixel's sample count, so the image always holds the mean
+//  of the samples taken so far.
+//  Rendering stops when every pixel has maxSpp samples (0 = no limit) or when
+//  the wall clock budget is exhausted (0 = no limit; one of them must be set).
+//  The budget is checked between tiles, so a pass may be left incomplete.
+//  If a checkpoint file is given, the accumulator is saved to it every
+//  checkpointInterval seconds (0 = after every pass) and when rendering stops;
+//  a Render() that finds a checkpoint for the same resolution, seed, maxSpp,
+//  sampler, scene and camera resumes from it (the budget counts from the
+//  resume) and refuses to render if the checkpoint is for another render.
+//  Samples carry on from each pixel's sample count, so a resumed render equals
+//  an uninterrupted one.
+//  Passes are split into tiles, distributed among a pool of worker threads
+//  (see ParallelRenderer).
+//
+
+#ifndef ProgressiveRenderer_hpp
+#define ProgressiveRenderer_hpp
+
+#include "ParallelRenderer.hpp"
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+class ProgressiveRenderer: public ParallelRenderer {
+private:
+    int passSpp, maxSpp;
+    double timeBudget;          // seconds, 0 = unlimited
+    std::string checkpoint;     // checkpoint file, "" = none
+    double checkpointInterval;  // seconds between checkpoints
+
+    std::atomic<long> passSamples;   // samples taken in the current pass
+    std::chrono::steady_clock::time_point start;
+
+    double Elapsed () const;
+    // hash of the scene and camera, to match checkpoints to renders
+    uint64_t SceneHash (int const W, int const H);
+    void RenderTile (Tile const& t, Sampler *smp);
+
+public:
+    VarianceBuffer accum;   // accumulated radiance and sample count per pixel
+
+    ProgressiveRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd,
+                        int _passSpp, int _maxSpp, double _timeBudget,
+                        std::string _checkpoint, double _checkpointInterval, bool _jitter,
+                        int _nThreads=0, int _tileSize=16, unsigned int _seed=0, Sampler *_sampler=NULL):
+        ParallelRenderer(cam, scene, img, shd, _maxSpp, _jitter, _nThreads, _tileSize, _seed, _sampler),
+        passSpp(_passSpp < 1 ? 1 : _passSpp), maxSpp(_maxSpp), timeBudget(_timeBudget),
+        checkpoint(_checkpoint), checkpointInterval(_checkpointInterval),
+        passSamples(0), accum(img->W, img->H) {}
+
+    void Render();
+};
+
+#endif /* ProgressiveRenderer_hpp */
@@ -6,7 +6,7 @@
 //
 
 #include "StandardRenderer.hpp"
-#include <random>
+#include <algorithm>
 
 /*
 void StandardRenderer::Render () {
@@ -65,51 +65,68 @@ void StandardRenderer::Render () {
 }
 */
 
+RGB StandardRenderer::RenderPixel (int const x, int const y, Sampler *smp) {
+    float const sppf = 1.f / spp;
+    RGB color(0., 0., 0.);
+
+    // primary rays are traced in packets of (up to) RayPacket::SIZE samples
+    for (int s0 = 0; s0 < spp; s0 += RayPacket::SIZE) {
+        RGB L[RayPacket::SIZE];
+        int const n = std::min(RayPacket::SIZE, spp - s0);
+
+        RenderPacket(x, y, s0, n, smp, L);
+        for (int s = 0; s < n; s++) color += L[s];
+    } // multiple samples
+
+    return color * sppf;
+}
+
+void StandardRenderer::RenderPacket (int const x, int const y, int const s0, int const n, Sampler *smp, RGB *L) {
+    // the shaders take their random numbers from the same sampler
+    Shader::SetSampler(smp);
+
+    RayPacket packet;
+    Intersection isect[RayPacket::SIZE];
+    packet.n = n;
+
+    // Generate Rays (camera)
+    for (int s = 0; s < n; s++) {
+        float jitterV[2], lens[2];
+
+        smp->StartPixelSample(x, y, s0 + s);
+        smp->Get2D(jitterV);
+        smp->Get2D(lens);
+        cam->GenerateRay(x, y, &packet.rays[s], (jitter ? jitterV : NULL), lens);
+    }
+    packet.Setup();
+
+    // Trace rays (scene)
+    int const hits = scene->trace4(packet, isect);
+
+    // Shade these intersections (shader) - remember: depth=0
+    for (int s = 0; s < n; s++) {
+        smp->StartPixelSample(x, y, s0 + s);
+        L[s] = shd->shade((hits & (1 << s)) != 0, isect[s], 0);
+    }
+}
+
 void StandardRenderer::Render() {
     int W = 0, H = 0;
-    int x, y, s;
-
-    // Random number generator
-    std::random_device rdev{};
-    std::mt19937 rng{rdev()};
-    std::uniform_real_distribution<float> U_dist{0.0, 1.0};
+    int x, y;
 
     // Get resolution from camera
     cam->getResolution(&W, &H);
-    float const sppf = 1.f / spp;
+
+    // a new frame for the per pixel light reservoirs (if any)
+    if (scene->reservoirs) scene->reservoirs->NextFrame();
 
     // Main rendering loop: get primary rays from the camera until done
     for (y = 0; y < H; y++) {  // loop over rows
         fprintf(stderr, "%d\r", y);
         fflush(stderr);
         for (x = 0; x < W; x++) { // loop over columns
-            RGB color(0., 0., 0.);
-
-            for (s = 0; s < spp; s++) {
-                Ray primary;
-                Intersection isect;
-                bool intersected;
-
-                // Generate Ray (camera)
-                float jitterV[2];
-
-                if (jitter) {
-                    jitterV[0] = U_dist(rng);
-                    jitterV[1] = U_dist(rng);
-                    cam->GenerateRay(x, y, &primary, jitterV);
-                } else {
-                    cam->GenerateRay(x, y, &primary);
-                }
-
-                // Trace ray (scene)
-                intersected = scene->trace(primary, &isect);
-
-                // Shade this intersection (shader) - remember: depth=0
-                color += shd->shade(intersected, isect, 0);
-            } // multiple samples
-
             // Write the result into the image frame buffer (image)
-            img->set(x, y, color * sppf);
+            img->set(x, y, RenderPixel(x, y, sampler));
         } // loop over columns
     }   // loop over rows
-}
\ No newline at end of file
+}
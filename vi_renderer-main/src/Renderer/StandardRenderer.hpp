@@ -9,21 +9,38 @@
 #define StandardRenderer_hpp
 
 #include "renderer.hpp"
+#include "sampler.hpp"
+#include "IndependentSampler.hpp"
 
 class StandardRenderer: public Renderer {
-private:
+protected:
     int spp;
     bool jitter;
-    
+    unsigned int seed;  // seed of the default sampler
+    Sampler *sampler;   // every render thread works on its own Clone() of it
+    bool ownSampler;
+
+    // render all samples of pixel (x,y) with the calling thread's sampler smp and return the averaged colour
+    // the result depends only on the sampler and (x, y), never on the order in which pixels are visited
+    RGB RenderPixel (int const x, int const y, Sampler *smp);
+    // render samples [s0, s0+n[ (n <= RayPacket::SIZE) of pixel (x,y) as one packet of primary rays;
+    // the radiance of each sample is returned in L[0..n[
+    void RenderPacket (int const x, int const y, int const s0, int const n, Sampler *smp, RGB *L);
+
 public:
     // Manter construtores simples (sem tone mapping)
-    StandardRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd, int _spp): 
-        Renderer(cam, scene, img, shd), spp(_spp), jitter(false) {}
-    
-    StandardRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd, int _spp, bool _jitter): 
-        Renderer(cam, scene, img, shd), spp(_spp), jitter(_jitter) {}
-    
+    StandardRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd, int _spp):
+        Renderer(cam, scene, img, shd), spp(_spp), jitter(false), seed(0),
+        sampler(new IndependentSampler(0)), ownSampler(true) {}
+
+    // _sampler: e.g. SobolSampler(spp, seed) ; NULL = IndependentSampler(_seed)
+    StandardRenderer(Camera *cam, Scene *scene, Image *img, Shader *shd, int _spp, bool _jitter, unsigned int _seed=0, Sampler *_sampler=NULL):
+        Renderer(cam, scene, img, shd), spp(_spp), jitter(_jitter), seed(_seed),
+        sampler(_sampler ? _sampler : new IndependentSampler(_seed)), ownSampler(_sampler == NULL) {}
+
+    ~StandardRenderer() { if (ownSampler) delete sampler; }
+
     void Render();
 };
 
-#endif /* StandardRenderer_hpp */
\ No newline at end of file
+#endif /* StandardRenderer_hpp */
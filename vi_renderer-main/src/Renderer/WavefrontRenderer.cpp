@@ -0,0 +1,167 @@
+//
+//  WavefrontRenderer.cpp
+//  VI-RT
+//
+
+#include "WavefrontRenderer.hpp"
+#include <algorithm>
+
+// camera rays for all the samples of all the pixels of the tile
+// (the same sampler dimensions as StandardRenderer::RenderPixel)
+void WavefrontRenderer::Generate (Tile const& t, Sampler *smp, PathQueue& q) {
+    int const tW = t.x1 - t.x0;
+    for (int y = t.y0; y < t.y1; y++) {
+        for (int x = t.x0; x < t.x1; x++) {
+            for (int s = 0; s < spp; s++) {
+                Ray primary;
+                float jitterV[2], lens[2];
+
+                smp->StartPixelSample(x, y, s);
+                smp->Get2D(jitterV);
+                smp->Get2D(lens);
+                cam->GenerateRay(x, y, &primary, (jitter ? jitterV : NULL), lens);
+                q.ray.push_back(primary);
+                q.beta.push_back(RGB(1., 1., 1.));
+                q.pdf.push_back(0.f);
+                q.from.push_back(primary.o);
+                q.fromN.push_back(Vector());     // camera rays are not weighted
+                q.pixel.push_back((y - t.y0) * tW + (x - t.x0));
+                q.sample.push_back(s);
+                q.depth.push_back(0);
+            }
+        }
+    }
+}
+
+// trace all the rays of the queue
+// camera rays are coherent: they are traced in packets of RayPacket::SIZE
+void WavefrontRenderer::Extend (PathQueue& q, bool const primary) {
+    int const n = (int)q.ray.size();
+    q.isect.resize(n);
+    q.hit.resize(n);
+
+    if (primary) {
+        for (int i0 = 0; i0 < n; i0 += RayPacket::SIZE) {
+            RayPacket packet;
+            packet.n = std::min(RayPacket::SIZE, n - i0);
+            for (int i = 0; i < packet.n; i++) packet.rays[i] = q.ray[i0 + i];
+            packet.Setup();
+            int const hits = scene->trace4(packet, &q.isect[i0]);
+            for (int i = 0; i < packet.n; i++) q.hit[i0 + i] = (hits & (1 << i)) != 0;
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        q.hit[i] = scene->trace(q.ray[i], &q.isect[i]);
+    }
+}
+
+// one path vertex for every path of the queue: the paths that continue go to next
+void WavefrontRenderer::Shade (Tile const& t, Sampler *smp, PathQueue& q, PathQueue& next, ShadowQueue& s, std::vector<RGB>& color) {
+    int const n = (int)q.ray.size();
+    int const tW = t.x1 - t.x0;
+    for (int i = 0; i < n; i++) {
+        Intersection const& isect = q.isect[i];
+        bool const intersected = q.hit[i] != 0;
+        int const pixel = q.pixel[i];
+        RGB beta = q.beta[i];
+
+        if (!intersected || isect.isLight) {
+            color[pixel] += beta * pt->Emitted(intersected, isect, q.pdf[i], q.from[i], q.fromN[i]);
+            continue;
+        }
+
+        // the dimensions PathTracing::shade would use at this vertex
+        smp->StartPixelSample(t.x0 + pixel % tW, t.y0 + pixel / tW, q.sample[i]);
+        smp->SetDimension(Sampler::VertexDimension(q.depth[i]));
+
+        if (!isect.f->Kd.isZero()) {
+            Ray shadow;
+            float maxL;
+            RGB L;
+            color[pixel] += beta * pt->DirectLighting(isect, &shadow, &maxL, &L);
+            if (!L.isZero()) {
+                s.ray.push_back(shadow);
+                s.maxL.push_back(maxL);
+                s.L.push_back(beta * L);
+                s.pixel.push_back(pixel);
+            }
+            color[pixel] += beta * pt->IndirectDiffuse(isect);
+        }
+
+        Ray r;
+        RGB weight;
+        float pdf;
+        if (pt->Scatter(isect, q.depth[i], &r, &weight, &pdf)) {
+            next.ray.push_back(r);
+            next.beta.push_back(beta * weight);
+            next.pdf.push_back(pdf);
+            next.from.push_back(isect.p);
+            next.fromN.push_back(isect.sn);
+            next.pixel.push_back(pixel);
+            next.sample.push_back(q.sample[i]);
+            next.depth.push_back(q.depth[i] + 1);
+        }
+    }
+}
+
+// add the light samples that reach their light
+void WavefrontRenderer::Shadow (ShadowQueue& s, std::vector<RGB>& color) {
+    int const n = (int)s.ray.size();
+    for (int i = 0; i < n; i++) {
+        if (scene->visibility(s.ray[i], s.maxL[i])) {
+            color[s.pixel[i]] += s.L[i];
+        }
+    }
+}
+
+void WavefrontRenderer::RenderTile (Tile const& t, Sampler *smp, WorkerState& w) {
+    int const tW = t.x1 - t.x0, tH = t.y1 - t.y0;
+    w.color.assign(tW * tH, RGB(0., 0., 0.));
+
+    PathQueue *q = &w.paths, *next = &w.next;
+    q->clear();
+    Generate(t, smp, *q);
+
+    for (bool primary = true; !q->ray.empty(); primary = false) {
+        next->clear();
+        w.shadows.clear();
+
+        Extend(*q, primary);
+        Shade(t, smp, *q, *next, w.shadows, w.color);
+        Shadow(w.shadows, w.color);
+        std::swap(q, next);
+    }
+
+    float const sppf = 1.f / spp;
+    for (int y = t.y0; y < t.y1; y++) {
+        for (int x = t.x0; x < t.x1; x++) {
+            img->set(x, y, w.color[(y - t.y0) * tW + (x - t.x0)] * sppf);
+        }
+    }
+}
+
+void WavefrontRenderer::Render() {
+    int W = 0, H = 0;
+
+    // Get resolution from camera
+    cam->getResolution(&W, &H);
+
+    // a new frame for the per pixel light reservoirs (if any)
+    if (scene->reservoirs) scene->reservoirs->NextFrame();
+
+    int const threads = MakeTiles(W, H);
+    workers.assign(threads, WorkerState());
+
+    fprintf(stdout, "Wavefront rendering %d tiles (%dx%d, %d paths each) with %d threads\n",
+            (int)tiles.size(), tileSize, tileSize, tileSize * tileSize * spp, threads);
+
+    // the random numbers depend only on (sampler, pixel, sample), never on the worker
+    RunTiles(threads, [this](int w, Tile const& t, Sampler *smp) {
+                 Shader::SetSampler(smp);
+                 RenderTile(t, smp, workers[w]);
+             }, std::function<bool()>(), true);
+    workers.clear();
+
+    fprintf(stderr, "\n");
+}
@@ -0,0 +1,83 @@
+//
+//  WavefrontRenderer.hpp
+//  VI-RT
+//
+//  Path tracing organised as a wavefront (Laine, Karras and Aila 2013,
+//  "Megakernels Considered Harmful: Wavefront Path Tracing on GPUs").
+//  Instead of following each path to its end, all the paths of a tile (every
+//  sample of every pixel) are kept in queues and advanced together, one stage
+//  at a time over the whole queue:
+//      generate : camera rays for all the samples of the tile
+//      extend   : trace every ray of the queue
+//      shade    : emission, one light sample (queued as a shadow ray) and
+//                 the next bounce (queued as a new path ray)
+//      shadow   : trace the shadow rays and add the unoccluded light samples
+//  extend, shade and shadow are repeated until no path is left.
+//  The shading is that of the PathTracing shader (see PathTracing::Emitted,
+//  PathTracing::DirectLighting and PathTracing::Scatter).
+//  Tiles are distributed among a pool of worker threads (see ParallelRenderer),
+//  each with its own queues.
+//
+
+#ifndef WavefrontRenderer_hpp
+#define WavefrontRenderer_hpp
+
+#include "ParallelRenderer.hpp"
+#include "PathTracingShader.hpp"
+#include <vector>
+
+class WavefrontRenderer: public ParallelRenderer {
+private:
+    PathTracing *pt;    // a tile has tileSize*tileSize*spp paths
+
+    // the paths being followed, one entry per path in each array (structure of arrays)
+    typedef struct {
+        std::vector<Ray> ray;               // next ray to trace
+        std::vector<Intersection> isect;    // its intersection (extend stage)
+        std::vector<char> hit;
+        std::vector<RGB> beta;              // path throughput
+        std::vector<float> pdf;             // of the ray's direction (see PathTracing::Scatter)
+        std::vector<Point> from;            // the vertex the ray left from and its normal (see PathTracing::Emitted)
+        std::vector<Vector> fromN;
+        std::vector<int> pixel;             // index of the pixel in the tile
+        std::vector<int> sample;            // sample index within the pixel
+        std::vector<int> depth;
+
+        void clear () { ray.clear(); beta.clear(); pdf.clear(); from.clear(); fromN.clear(); pixel.clear(); sample.clear(); depth.clear(); }
+    } PathQueue;
+
+    // light samples waiting for their shadow test
+    typedef struct {
+        std::vector<Ray> ray;
+        std::vector<float> maxL;            // distance to the light
+        std::vector<RGB> L;                 // contribution if unoccluded (throughput included)
+        std::vector<int> pixel;
+
+        void clear () { ray.clear(); maxL.clear(); L.clear(); pixel.clear(); }
+    } ShadowQueue;
+
+    // per worker state, reused for all the tiles of the worker
+    typedef struct {
+        PathQueue paths, next;
+        ShadowQueue shadows;
+        std::vector<RGB> color;             // accumulated radiance, one per pixel of the tile
+    } WorkerState;
+
+    std::vector<WorkerState> workers;
+
+    void Generate (Tile const& t, Sampler *smp, PathQueue& q);
+    void Extend (PathQueue& q, bool const primary);
+    void Shade (Tile const& t, Sampler *smp, PathQueue& q, PathQueue& next, ShadowQueue& s, std::vector<RGB>& color);
+    void Shadow (ShadowQueue& s, std::vector<RGB>& color);
+    void RenderTile (Tile const& t, Sampler *smp, WorkerState& w);
+
+public:
+    WavefrontRenderer(Camera *cam, Scene *scene, Image *img, PathTracing *shd, int _spp, bool _jitter,
+                      int _nThreads=0, int _tileSize=32, unsigned int _seed=0, Sampler *_sampler=NULL):
+        ParallelRenderer(cam, scene, img, shd, _spp, _jitter, _nThreads, _tileSize, _seed, _sampler),
+        pt(shd) {}
+
+    void Render();
+};
+
+#endif /* WavefrontRenderer_hpp */
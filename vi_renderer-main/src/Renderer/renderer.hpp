@@ -19,6 +19,7 @@ protected:
     Scene *scene;
     Image * img;
     Shader *shd;
+
 public:
     Renderer (Camera *cam, Scene * scene, Image * img, Shader *shd): cam(cam), scene(scene), img(img), shd(shd) {}
     virtual void Render () {}
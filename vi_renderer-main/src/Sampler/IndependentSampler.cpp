@@ -0,0 +1,18 @@
+//
+//  IndependentSampler.cpp
+//  VI-RT
+//
+
+#include "IndependentSampler.hpp"
+
+void IndependentSampler::StartPixelSample (int const x, int const y, int const _index) {
+    sequence = HashPixel(x, y, seed);
+    index = _index;
+    SetDimension(0);
+}
+
+// each sample owns 2^32 consecutive numbers of the pixel's sequence
+void IndependentSampler::SetDimension (int const dim) {
+    rng.SetSequence(sequence);
+    rng.Advance(((uint64_t)(uint32_t)index << 32) + (uint32_t)dim);
+}
@@ -0,0 +1,36 @@
+//
+//  IndependentSampler.hpp
+//  VI-RT
+//
+//  Uniform independent random numbers: every pixel has its own PCG32 sequence
+//  and each (sample, dimension) is a fixed position along it, reached by jumping
+//  ahead, so the generator behaves as a counter based one
+//
+
+#ifndef IndependentSampler_hpp
+#define IndependentSampler_hpp
+
+#include "sampler.hpp"
+#include "PCG32.hpp"
+
+class IndependentSampler: public Sampler {
+    unsigned int seed;
+    uint64_t sequence;  // this pixel's sequence
+    int index;          // sample index
+    PCG32 rng;
+public:
+    IndependentSampler (unsigned int const _seed = 0): seed(_seed), sequence(0), index(0) {}
+
+    void StartPixelSample (int const x, int const y, int const _index);
+    void SetDimension (int const dim);
+    float Get1D () { return rng.UniformFloat(); }
+    void Get2D (float *u) {
+        u[0] = rng.UniformFloat();
+        u[1] = rng.UniformFloat();
+    }
+    Sampler *Clone () const { return new IndependentSampler(seed); }
+    std::string Name () const { return "Independent"; }
+    unsigned int Seed () const { return seed; }
+};
+
+#endif /* IndependentSampler_hpp */
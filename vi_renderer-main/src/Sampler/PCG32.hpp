@@ -0,0 +1,58 @@
+//
+//  PCG32.hpp
+//  VI-RT
+//
+//  PCG32 random number generator (O'Neill 2014, pcg-random.org; as in pbrt-v4)
+//  16 bytes of state, 2^63 independent sequences and O(log n) jump ahead,
+//  so that any (sequence, position) can be reached directly
+//
+
+#ifndef PCG32_hpp
+#define PCG32_hpp
+
+#include "sampler.hpp"
+#include <algorithm>
+
+class PCG32 {
+    uint64_t state, inc;
+    static const uint64_t Mult = 0x5851f42d4c957f2dull;
+public:
+    PCG32 (): state(0x853c49e6748fea9bull), inc(0xda3e39cb94b95bdbull) {}
+    PCG32 (uint64_t const sequence) { SetSequence(sequence); }
+
+    // start sequence number sequence at its beginning
+    void SetSequence (uint64_t const sequence) {
+        state = 0u;
+        inc = (sequence << 1u) | 1u;
+        Uniform32();
+        state += MixBits(sequence);
+        Uniform32();
+    }
+    uint32_t Uniform32 () {
+        uint64_t const old = state;
+        state = old * Mult + inc;
+        uint32_t const xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t const rot = (uint32_t)(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+    }
+    // in [0,1[
+    float UniformFloat () {
+        return std::min(OneMinusEpsilon, Uniform32() * 2.3283064365386963e-10f);
+    }
+    // skip delta numbers of the sequence (Brown, "Random number generation with arbitrary strides")
+    void Advance (uint64_t delta) {
+        uint64_t curMult = Mult, curPlus = inc, accMult = 1u, accPlus = 0u;
+        while (delta > 0) {
+            if (delta & 1) {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+            delta /= 2;
+        }
+        state = accMult * state + accPlus;
+    }
+};
+
+#endif /* PCG32_hpp */
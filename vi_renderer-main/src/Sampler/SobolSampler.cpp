@@ -0,0 +1,104 @@
+//
+//  SobolSampler.cpp
+//  VI-RT
+//
+
+#include "SobolSampler.hpp"
+#include <algorithm>
+
+static inline uint32_t ReverseBits32 (uint32_t v) {
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+    v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+    v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+    v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+    return v;
+}
+
+// generator matrix of the 2nd Sobol' dimension (primitive polynomial x+1)
+struct SobolMatrix1 {
+    uint32_t v[32];
+    SobolMatrix1 () {
+        v[0] = 1u << 31;
+        for (int k = 1; k < 32; k++) v[k] = v[k-1] ^ (v[k-1] >> 1);
+    }
+};
+static const SobolMatrix1 Sobol1;
+
+// dimension 0 or 1 of Sobol' point number i, as 32 bits
+static inline uint32_t Sobol (uint32_t i, int const d) {
+    if (d == 0) return ReverseBits32(i);   // van der Corput
+    uint32_t r = 0;
+    for (int k = 0; i; i >>= 1, k++) {
+        if (i & 1) r ^= Sobol1.v[k];
+    }
+    return r;
+}
+
+// hash based nested uniform (Owen) scrambling (pbrt-v4's FastOwenScrambler,
+// after Laine and Karras 2011 and Burley 2020)
+static inline uint32_t OwenScramble (uint32_t v, uint32_t const seed) {
+    v = ReverseBits32(v);
+    v ^= v * 0x3d20adea;
+    v += seed;
+    v *= (seed >> 16) | 1;
+    v ^= v * 0x05526c56;
+    v ^= v * 0x53a22864;
+    return ReverseBits32(v);
+}
+
+static inline float ToFloat (uint32_t const v) {
+    return std::min(OneMinusEpsilon, v * 2.3283064365386963e-10f);
+}
+
+// element i of a random permutation p of [0, l[ (Kensler 2013, "Correlated Multi-Jittered Sampling")
+static uint32_t PermutationElement (uint32_t i, uint32_t const l, uint32_t const p) {
+    uint32_t w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= p;
+        i *= 0xe170893d;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3f;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+    return (i + p) % l;
+}
+
+uint32_t SobolSampler::Shuffled (uint64_t const h) const {
+    // samples beyond spp are not shuffled
+    if (spp <= 1 || index >= spp) return (uint32_t)index;
+    return PermutationElement((uint32_t)index, (uint32_t)spp, (uint32_t)h);
+}
+
+float SobolSampler::Get1D () {
+    uint64_t const h = MixBits(pixelHash ^ ((uint64_t)(uint32_t)dim << 1));
+    dim++;
+    return ToFloat(OwenScramble(Sobol(Shuffled(h), 0), (uint32_t)(h >> 32)));
+}
+
+void SobolSampler::Get2D (float *u) {
+    uint64_t const h = MixBits(pixelHash ^ ((uint64_t)(uint32_t)dim << 1));
+    dim += 2;
+    uint32_t const i = Shuffled(h);
+    uint64_t const h2 = MixBits(h);
+    u[0] = ToFloat(OwenScramble(Sobol(i, 0), (uint32_t)(h >> 32)));
+    u[1] = ToFloat(OwenScramble(Sobol(i, 1), (uint32_t)(h2 >> 32)));
+}
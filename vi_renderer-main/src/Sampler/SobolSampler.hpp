@@ -0,0 +1,42 @@
+//
+//  SobolSampler.hpp
+//  VI-RT
+//
+//  Low discrepancy samples: Owen scrambled Sobol' points, padded (pbrt-v4's
+//  PaddedSobolSampler). Every pair of dimensions is a 2D (0,2)-sequence (the first
+//  two Sobol' dimensions) whose sample order is shuffled and whose points are Owen
+//  scrambled with seeds hashed from (pixel, dimension), so dimensions are not
+//  correlated with each other nor pixels with their neighbours.
+//  Stratification is best when spp is a power of 2.
+//
+
+#ifndef SobolSampler_hpp
+#define SobolSampler_hpp
+
+#include "sampler.hpp"
+
+class SobolSampler: public Sampler {
+    int spp;
+    unsigned int seed;
+    uint64_t pixelHash;
+    int index, dim;
+
+    // sample index for dimension hash h: a permutation of [0, spp[
+    uint32_t Shuffled (uint64_t const h) const;
+public:
+    SobolSampler (int const _spp, unsigned int const _seed = 0): spp(_spp), seed(_seed), pixelHash(0), index(0), dim(0) {}
+
+    void StartPixelSample (int const x, int const y, int const _index) {
+        pixelHash = HashPixel(x, y, seed);
+        index = _index;
+        dim = 0;
+    }
+    void SetDimension (int const _dim) { dim = _dim; }
+    float Get1D ();
+    void Get2D (float *u);
+    Sampler *Clone () const { return new SobolSampler(spp, seed); }
+    std::string Name () const { return "Sobol " + std::to_string(spp); }
+    unsigned int Seed () const { return seed; }
+};
+
+#endif /* SobolSampler_hpp */
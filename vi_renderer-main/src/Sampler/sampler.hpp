@@ -0,0 +1,63 @@
+//
+//  sampler.hpp
+//  VI-RT
+//
+//  Source of the random numbers of one pixel sample (pbrt-v4, sec. 8.3).
+//  A pixel sample is a point in a high dimensional unit hypercube: the camera
+//  uses the first CameraDimensions and each path vertex owns the following
+//  VertexDimensions. The number returned for a given (pixel, sample index,
+//  dimension) never depends on the thread, the renderer or the order in which
+//  samples are taken, so images are reproducible.
+//  Samplers hold the state of the current sample: each render thread uses its
+//  own copy (Clone).
+//
+
+#ifndef sampler_hpp
+#define sampler_hpp
+
+#include <cstdint>
+#include <string>
+
+class Sampler {
+public:
+    // pixel jitter (2) and lens (2)
+    static const int CameraDimensions = 4;
+    // dimensions reserved for each path vertex (enough for ALL_LIGHTS with 2000 area lights)
+    static const int VertexDimensions = 1 << 12;
+    // first dimension of the path vertex at depth
+    static int VertexDimension (int const depth) { return CameraDimensions + depth * VertexDimensions; }
+
+    virtual ~Sampler () {}
+    // start sample number index of pixel (x,y), at dimension 0
+    virtual void StartPixelSample (int const x, int const y, int const index) = 0;
+    // move to dimension dim of the current sample
+    virtual void SetDimension (int const dim) = 0;
+    // next dimension(s) of the current sample, in [0,1[
+    virtual float Get1D () = 0;
+    virtual void Get2D (float *u) = 0;
+    // a new sampler with the same parameters, for another thread
+    virtual Sampler *Clone () const = 0;
+    // the type and parameters (other than the seed) that determine the sequence, e.g., "Sobol 1024"
+    virtual std::string Name () const = 0;
+    virtual unsigned int Seed () const = 0;
+};
+
+// hashing used to decorrelate pixels, samples and dimensions
+// (the splitmix64 finalizer, as in pbrt-v4's MixBits)
+inline uint64_t MixBits (uint64_t v) {
+    v ^= (v >> 31);
+    v *= 0x7fb5d329728ea185ull;
+    v ^= (v >> 27);
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= (v >> 33);
+    return v;
+}
+
+inline uint64_t HashPixel (int const x, int const y, uint64_t const seed) {
+    return MixBits(((uint64_t)(uint32_t)x << 32) ^ (uint64_t)(uint32_t)y ^ MixBits(seed));
+}
+
+// largest float below 1
+static const float OneMinusEpsilon = 0.99999994f;
+
+#endif /* sampler_hpp */
@@ -0,0 +1,89 @@
+//
+//  LightDistribution.cpp
+//  VI-RT
+//
+
+#include "LightDistribution.hpp"
+#include "PointLight.hpp"
+#include "AreaLight.hpp"
+
+float LightDistribution::Power (Light *l) {
+    if (l->type == AREA_LIGHT) {
+        AreaLight* al = (AreaLight*)l;
+        // Para área lights, potência = intensidade * área
+        return (al->power.R + al->power.G + al->power.B) * al->gem->area();
+    }
+    if (l->type == POINT_LIGHT) {
+        PointLight* pl = (PointLight*)l;
+        // Para point lights, tratamos como tendo "área" 1
+        return (pl->color.R + pl->color.G + pl->color.B);
+    }
+    // Ambient lights não participam nesta seleção
+    return 0.f;
+}
+
+LightDistribution::LightDistribution (const std::vector<Light *>& lights) {
+    pdfs.assign(lights.size(), 0.f);
+
+    std::vector<float> power;
+    double total = 0.;
+    for (size_t i = 0; i < lights.size(); i++) {
+        if (lights[i]->type == AMBIENT_LIGHT) {
+            ambient.push_back(lights[i]);
+            continue;
+        }
+        float const p = Power(lights[i]);
+        if (p > 0.f) {
+            lightNdx.push_back((int)i);
+            power.push_back(p);
+            total += p;
+        }
+    }
+
+    int const n = (int)lightNdx.size();
+    threshold.assign(n, 1.f);
+    alias.resize(n);
+    if (n == 0) return;
+
+    // probabilidades escaladas por n: entradas com < 1 são completadas por uma com > 1
+    std::vector<double> scaled(n);
+    std::vector<int> small, large;
+    for (int i = 0; i < n; i++) {
+        pdfs[lightNdx[i]] = (float)(power[i] / total);
+        scaled[i] = power[i] * n / total;
+        alias[i] = i;
+        if (scaled[i] < 1.) small.push_back(i);
+        else large.push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        int const s = small.back(); small.pop_back();
+        int const l = large.back();
+        threshold[s] = (float)scaled[s];
+        alias[s] = l;
+        scaled[l] -= 1. - scaled[s];
+        if (scaled[l] < 1.) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // as que sobram têm probabilidade 1 (a menos de erros de arredondamento)
+    for (int i : small) threshold[i] = 1.f;
+    for (int i : large) threshold[i] = 1.f;
+}
+
+int LightDistribution::Sample (float const u, float *pdf) const {
+    int const n = (int)lightNdx.size();
+    if (n == 0) {
+        *pdf = 0.f;
+        return -1;
+    }
+    // a parte inteira de u*n escolhe a entrada, a parte fracionária decide entre ela e o alias
+    float const un = u * n;
+    int i = (int)un;
+    if (i >= n) i = n - 1;
+    float const frac = un - i;
+    int const e = (frac < threshold[i]) ? i : alias[i];
+
+    *pdf = pdfs[lightNdx[e]];
+    return lightNdx[e];
+}
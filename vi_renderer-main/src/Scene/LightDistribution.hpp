@@ -0,0 +1,39 @@
+//
+//  LightDistribution.hpp
+//  VI-RT
+//
+//  Distribuição das luzes da cena proporcional à sua potência, construída uma
+//  vez (Scene::BuildLightDistribution) e amostrada em O(1) com uma alias table
+//  (método de Walker, construção de Vose)
+//
+
+#ifndef LightDistribution_hpp
+#define LightDistribution_hpp
+
+#include "light.hpp"
+#include <vector>
+
+class LightDistribution {
+    // uma entrada por luz amostrável (point e area lights com potência > 0)
+    std::vector<float> threshold;   // probabilidade de ficar com a própria entrada
+    std::vector<int> alias;         // entrada alternativa
+    std::vector<int> lightNdx;      // entrada -> índice em Scene::lights
+    std::vector<float> pdfs;        // índice em Scene::lights -> probabilidade de seleção
+    std::vector<Light *> ambient;   // luzes ambiente: não são amostradas, contribuem sempre
+public:
+    LightDistribution (const std::vector<Light *>& lights);
+
+    // potência estimada de uma luz (a mesma medida para todos os tipos)
+    static float Power (Light *l);
+
+    // escolhe uma luz com probabilidade proporcional à sua potência, com um único
+    // número aleatório u em [0,1[ ; devolve o índice em Scene::lights (-1 se não houver)
+    int Sample (float const u, float *pdf) const;
+    // probabilidade de Sample escolher a luz de índice l_ndx
+    float Pdf (int const l_ndx) const { return (l_ndx >= 0 && l_ndx < (int)pdfs.size()) ? pdfs[l_ndx] : 0.f; }
+
+    int Count () const { return (int)lightNdx.size(); }
+    const std::vector<Light *>& AmbientLights () const { return ambient; }
+};
+
+#endif /* LightDistribution_hpp */
@@ -0,0 +1,242 @@
+//
+//  LightTree.cpp
+//  VI-RT
+//
+
+#include "LightTree.hpp"
+#include "LightDistribution.hpp"
+#include "PointLight.hpp"
+#include "AreaLight.hpp"
+#include "BB_extensions.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const float PI_F = 3.14159265358979f;
+
+static inline float SafeSqrt (float x) { return sqrtf(std::max(0.f, x)); }
+static inline float SafeACos (float x) { return acosf(std::min(1.f, std::max(-1.f, x))); }
+
+// cos(theta_a - theta_b) e sin(theta_a - theta_b), limitados a 0 quando theta_a < theta_b
+static inline float CosSubClamped (float sin_a, float cos_a, float sin_b, float cos_b) {
+    if (cos_a > cos_b) return 1.f;
+    return cos_a * cos_b + sin_a * sin_b;
+}
+static inline float SinSubClamped (float sin_a, float cos_a, float sin_b, float cos_b) {
+    if (cos_a > cos_b) return 0.f;
+    return sin_a * cos_b - cos_a * sin_b;
+}
+
+// cos do semiângulo do cone de direções de p para a caixa (esfera envolvente)
+static float BoundSubtendedDirections (BB const& b, Point const& p) {
+    if (p.X >= b.min.X && p.X <= b.max.X && p.Y >= b.min.Y && p.Y <= b.max.Y &&
+        p.Z >= b.min.Z && p.Z <= b.max.Z) return -1.f;
+    Point const c = Centroid(b);
+    float const r2 = b.min.vec2point(b.max).normSQ() / 4.f;
+    float const d2 = p.vec2point(c).normSQ();
+    if (d2 < r2) return -1.f;
+    return SafeSqrt(1.f - r2 / d2);
+}
+
+float LightBounds::Importance (Point const& p, Vector const& n) const {
+    Point const pc = Centroid(bounds);
+    Vector wi = pc.vec2point(p);
+    float d2 = wi.normSQ();
+    // pontos dentro ou muito perto da caixa: limitar a distância
+    d2 = std::max(d2, sqrtf(bounds.min.vec2point(bounds.max).normSQ()) / 2.f);
+    wi.normalize();
+
+    float const cosTheta_w = w.dot(wi);
+    float const sinTheta_w = SafeSqrt(1.f - cosTheta_w * cosTheta_w);
+    float const cosTheta_b = BoundSubtendedDirections(bounds, p);
+    float const sinTheta_b = SafeSqrt(1.f - cosTheta_b * cosTheta_b);
+
+    // menor ângulo entre wi e uma direção de emissão possível
+    float const sinTheta_o = SafeSqrt(1.f - cosTheta_o * cosTheta_o);
+    float const cosTheta_x = CosSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+    float const sinTheta_x = SinSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+    float const cosThetap = CosSubClamped(sinTheta_x, cosTheta_x, sinTheta_b, cosTheta_b);
+    if (cosThetap <= cosTheta_e) return 0.f;
+
+    float importance = phi * cosThetap / d2;
+
+    // cos no ponto de shading (n == 0 : sem normal)
+    if (n.X != 0.f || n.Y != 0.f || n.Z != 0.f) {
+        float const cosTheta_i = std::abs(wi.dot(n));
+        float const sinTheta_i = SafeSqrt(1.f - cosTheta_i * cosTheta_i);
+        importance *= CosSubClamped(sinTheta_i, cosTheta_i, sinTheta_b, cosTheta_b);
+    }
+    return std::max(importance, 0.f);
+}
+
+// rotação de v de um ângulo theta à volta do eixo (normalizado) a (Rodrigues)
+static Vector RotateAround (Vector const& v, Vector const& a, float const theta) {
+    float const c = cosf(theta), s = sinf(theta);
+    return v * c + a.cross(v) * s + a * (a.dot(v) * (1.f - c));
+}
+
+// união de dois limites de luzes (pbrt-v4: Union(LightBounds), Union(DirectionCone))
+static LightBounds Union (LightBounds const& a, LightBounds const& b) {
+    if (a.phi == 0.f) return b;
+    if (b.phi == 0.f) return a;
+
+    LightBounds r;
+    r.bounds = Union(a.bounds, b.bounds);
+    r.phi = a.phi + b.phi;
+    r.cosTheta_e = std::min(a.cosTheta_e, b.cosTheta_e);
+
+    // cone que contém os dois cones de normais
+    float const theta_a = SafeACos(a.cosTheta_o), theta_b = SafeACos(b.cosTheta_o);
+    float const theta_d = SafeACos(a.w.dot(b.w));
+    if (std::min(theta_d + theta_b, PI_F) <= theta_a) {
+        r.w = a.w; r.cosTheta_o = a.cosTheta_o;
+        return r;
+    }
+    if (std::min(theta_d + theta_a, PI_F) <= theta_b) {
+        r.w = b.w; r.cosTheta_o = b.cosTheta_o;
+        return r;
+    }
+    float const theta_o = (theta_a + theta_d + theta_b) / 2.f;
+    Vector wr = a.w.cross(b.w);
+    if (theta_o >= PI_F || wr.normSQ() == 0.f) {
+        // esfera inteira
+        r.w = Vector(0., 0., 1.); r.cosTheta_o = -1.f;
+        return r;
+    }
+    wr.normalize();
+    r.w = RotateAround(a.w, wr, theta_o - theta_a);
+    r.w.normalize();
+    r.cosTheta_o = cosf(theta_o);
+    return r;
+}
+
+LightTree::LightTree (const std::vector<Light *>& lights) {
+    std::vector<std::pair<int, LightBounds>> bounded;
+    bitTrail.assign(lights.size(), 0);
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        Light *l = lights[i];
+        LightBounds lb;
+        lb.phi = LightDistribution::Power(l);
+        if (l->type == AMBIENT_LIGHT) {
+            ambient.push_back(l);
+            continue;
+        }
+        if (lb.phi <= 0.f) continue;
+        if (l->type == AREA_LIGHT) {
+            // emite para o lado da normal, em todo o hemisfério
+            AreaLight *al = (AreaLight *)l;
+            lb.bounds = al->gem->WorldBound();
+            lb.w = al->gem->normal;
+            lb.cosTheta_o = 1.f;
+            lb.cosTheta_e = 0.f;
+        } else if (l->type == POINT_LIGHT) {
+            // emite em todas as direções
+            PointLight *pl = (PointLight *)l;
+            lb.bounds.min = pl->pos;
+            lb.bounds.max = pl->pos;
+            lb.w = Vector(0., 0., 1.);
+            lb.cosTheta_o = -1.f;
+            lb.cosTheta_e = 0.f;
+        } else continue;
+        bounded.push_back(std::make_pair((int)i, lb));
+    }
+    if (bounded.empty()) return;
+
+    nodes.reserve(2 * bounded.size() - 1);
+    build(bounded, 0, (int)bounded.size(), 0, 0);
+}
+
+// constrói a subárvore de lights[start, end[ e devolve o índice da sua raiz
+// divide pela mediana dos centróides no eixo de maior extensão
+int LightTree::build (std::vector<std::pair<int, LightBounds>>& lights, int start, int end,
+                      uint64_t trail, int depth) {
+    int const myIndex = (int)nodes.size();
+    nodes.push_back(LightTreeNode());
+
+    if (end - start == 1 || depth == 63) {
+        // profundidade máxima (não acontece na prática): folha com a mais potente
+        int best = start;
+        for (int i = start + 1; i < end; i++) {
+            if (lights[i].second.phi > lights[best].second.phi) best = i;
+        }
+        nodes[myIndex].lb = lights[best].second;
+        nodes[myIndex].light = lights[best].first;
+        nodes[myIndex].child1 = -1;
+        bitTrail[lights[best].first] = trail;
+        return myIndex;
+    }
+
+    BB centroids;
+    centroids.min = centroids.max = Centroid(lights[start].second.bounds);
+    for (int i = start + 1; i < end; i++) {
+        centroids = Union(centroids, Centroid(lights[i].second.bounds));
+    }
+    int const dim = MaximumExtent(centroids);
+    int const mid = (start + end) / 2;
+    std::nth_element(lights.begin() + start, lights.begin() + mid, lights.begin() + end,
+                     [dim](const std::pair<int, LightBounds>& a, const std::pair<int, LightBounds>& b) {
+                         return Coord(Centroid(a.second.bounds), dim) < Coord(Centroid(b.second.bounds), dim);
+                     });
+
+    build(lights, start, mid, trail, depth + 1);
+    int const c1 = build(lights, mid, end, trail | ((uint64_t)1 << depth), depth + 1);
+
+    nodes[myIndex].child1 = c1;
+    nodes[myIndex].light = -1;
+    nodes[myIndex].lb = Union(nodes[myIndex + 1].lb, nodes[c1].lb);
+    return myIndex;
+}
+
+int LightTree::Sample (Point const& p, Vector const& n, float u, float *pdf) const {
+    *pdf = 0.f;
+    if (nodes.empty()) return -1;
+
+    float pmf = 1.f;
+    int node = 0;
+    // uma só luz: a raiz é folha
+    if (nodes[0].light >= 0) {
+        if (nodes[0].lb.Importance(p, n) <= 0.f) return -1;
+        *pdf = 1.f;
+        return nodes[0].light;
+    }
+    while (nodes[node].light < 0) {
+        int const c[2] = { node + 1, nodes[node].child1 };
+        float const ci[2] = { nodes[c[0]].lb.Importance(p, n), nodes[c[1]].lb.Importance(p, n) };
+        if (ci[0] == 0.f && ci[1] == 0.f) return -1;
+
+        // escolher um filho e reaproveitar u, reescalado para [0,1[
+        float const p0 = ci[0] / (ci[0] + ci[1]);
+        if (u < p0) {
+            node = c[0];
+            pmf *= p0;
+            u = std::min(u / p0, 0.99999994f);
+        } else {
+            node = c[1];
+            pmf *= 1.f - p0;
+            u = std::min((u - p0) / (1.f - p0), 0.99999994f);
+        }
+    }
+    *pdf = pmf;
+    return nodes[node].light;
+}
+
+float LightTree::Pdf (Point const& p, Vector const& n, int const l_ndx) const {
+    if (nodes.empty() || l_ndx < 0 || l_ndx >= (int)bitTrail.size()) return 0.f;
+
+    uint64_t trail = bitTrail[l_ndx];
+    float pmf = 1.f;
+    int node = 0;
+    if (nodes[0].light >= 0) {
+        return (nodes[0].light == l_ndx && nodes[0].lb.Importance(p, n) > 0.f) ? 1.f : 0.f;
+    }
+    while (nodes[node].light < 0) {
+        int const c[2] = { node + 1, nodes[node].child1 };
+        float const ci[2] = { nodes[c[0]].lb.Importance(p, n), nodes[c[1]].lb.Importance(p, n) };
+        int const side = (int)(trail & 1);
+        if (ci[side] == 0.f) return 0.f;
+        pmf *= ci[side] / (ci[0] + ci[1]);
+        node = c[side];
+        trail >>= 1;
+    }
+    return (nodes[node].light == l_ndx) ? pmf : 0.f;
+}
@@ -0,0 +1,59 @@
+//
+//  LightTree.hpp
+//  VI-RT
+//
+//  Árvore de luzes para amostragem de muitas luzes (Conty & Kulla 2018,
+//  "Importance Sampling of Many Lights with Adaptive Tree Splitting";
+//  limites de importância como no pbrt-v4, sec. 12.6.3)
+//  Cada nó guarda a caixa, a potência e o cone de orientações das luzes que contém;
+//  a amostragem desce da raiz escolhendo um dos filhos com probabilidade
+//  proporcional à contribuição estimada no ponto de shading, em O(log n)
+//
+
+#ifndef LightTree_hpp
+#define LightTree_hpp
+
+#include "light.hpp"
+#include "BB.hpp"
+#include <vector>
+#include <cstdint>
+
+// limites de um conjunto de luzes: caixa, potência total phi e cone de emissão
+// (eixo w, abertura das normais theta_o e dispersão da emissão theta_e à volta das normais)
+typedef struct LightBounds {
+    BB bounds;
+    float phi;
+    Vector w;
+    float cosTheta_o, cosTheta_e;
+
+    // contribuição estimada das luzes no ponto p com normal n (majorante, pbrt-v4)
+    float Importance (Point const& p, Vector const& n) const;
+} LightBounds;
+
+class LightTree {
+    typedef struct {
+        LightBounds lb;
+        int child1;     // interior: índice do 2º filho (o 1º é o nó seguinte)
+        int light;      // folha: índice em Scene::lights ; -1 = nó interior
+    } LightTreeNode;
+
+    std::vector<LightTreeNode> nodes;
+    std::vector<uint64_t> bitTrail;   // índice em Scene::lights -> caminho desde a raiz (1 bit por nível)
+    std::vector<Light *> ambient;     // luzes ambiente: não são amostradas, contribuem sempre
+
+    int build (std::vector<std::pair<int, LightBounds>>& lights, int start, int end, uint64_t trail, int depth);
+public:
+    LightTree (const std::vector<Light *>& lights);
+
+    // escolhe uma luz para o ponto p com normal n com um único número aleatório u em [0,1[
+    // devolve o índice em Scene::lights e a sua probabilidade (-1 se nenhuma contribui)
+    int Sample (Point const& p, Vector const& n, float u, float *pdf) const;
+    // probabilidade de Sample escolher a luz l_ndx no ponto p com normal n
+    // (pesos MIS dos raios da BRDF que atingem luzes, ver directLightingMIS)
+    float Pdf (Point const& p, Vector const& n, int const l_ndx) const;
+
+    int Count () const { return (int)(nodes.size() + 1) / 2; }
+    const std::vector<Light *>& AmbientLights () const { return ambient; }
+};
+
+#endif /* LightTree_hpp */
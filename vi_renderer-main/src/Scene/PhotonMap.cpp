@@ -0,0 +1,288 @@
+//
+//  PhotonMap.cpp
+//  VI-RT
+//
+
+#include "PhotonMap.hpp"
+#include "scene.hpp"
+#include "AreaLight.hpp"
+#include "PointLight.hpp"
+#include "PCG32.hpp"
+#include "ray.hpp"
+#include "BB_extensions.hpp"
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include "Shader_Utils.hpp"
+
+// limite de ressaltos de um fotão (evita ciclos entre superfícies especulares)
+#define MAX_PHOTON_DEPTH 16
+// um ponto com a irradiância pré-calculada por cada PRECOMPUTE_STRIDE fotões
+#define PRECOMPUTE_STRIDE 4
+// coseno mínimo entre a normal de um ponto pré-calculado e a do ponto consultado
+#define MIN_NORMAL_COS 0.9f
+
+// ponto e direção de emissão de um fotão da luz l
+static bool EmitRay (Light *l, PCG32& rng, Ray *r) {
+    if (l->type == AREA_LIGHT) {
+        AreaLight *al = (AreaLight *)l;
+        float rnd[2] = {rng.UniformFloat(), rng.UniformFloat()};
+        Point p;
+        al->Sample_L(rnd, &p);
+        // direção distribuída pelo coseno à volta da normal do emissor
+        rnd[0] = rng.UniformFloat();
+        rnd[1] = rng.UniformFloat();
+        Vector D_around_Z, Rx, Ry;
+        CosineHemiSphereSample(rnd, D_around_Z);
+        al->gem->normal.CoordinateSystem(&Rx, &Ry);
+        *r = Ray(p, D_around_Z.Rotate(Rx, Ry, al->gem->normal), DIFF_REFL);
+        r->adjustOrigin(al->gem->normal);
+        return true;
+    }
+    if (l->type == POINT_LIGHT) {
+        // direção uniforme na esfera
+        float const z = 1.f - 2.f * rng.UniformFloat();
+        float const rxy = sqrtf(std::max(0.f, 1.f - z * z));
+        float const phi = 2.f * (float)M_PI * rng.UniformFloat();
+        *r = Ray(((PointLight *)l)->pos, Vector(rxy * cosf(phi), rxy * sinf(phi), z), DIFF_REFL);
+        return true;
+    }
+    return false;
+}
+
+// fluxo emitido pela luz l: Le * área * pi (área) ou 4 pi I (pontual)
+// Le é a radiância usada pela iluminação direta (AreaLight::intensity)
+static RGB LightFlux (Light *l) {
+    if (l->type == AREA_LIGHT) return ((AreaLight *)l)->intensity * (((AreaLight *)l)->gem->area() * (float)M_PI);
+    if (l->type == POINT_LIGHT) return ((PointLight *)l)->color * (4.f * (float)M_PI);
+    return RGB(0., 0., 0.);
+}
+
+// segue um fotão de fluxo power ao longo de r, guardando-o nas superfícies difusas
+// que atinge depois do primeiro ressalto (lobo escolhido pela luminância, como em PathTracing::Scatter)
+static void TracePhoton (Scene *scene, Ray r, RGB power, int const maxDiffuse, PCG32& rng, std::vector<Photon>& out) {
+    int diffuse = 0;
+    float eta = 1.f;    // índice de refração do meio onde o fotão se propaga
+
+    for (int depth = 0; depth < MAX_PHOTON_DEPTH; depth++) {
+        Intersection isect;
+        isect.isLight = false;
+        r.pix_x = r.pix_y = 0;
+        if (!scene->trace(r, &isect) || isect.isLight) return;
+
+        BRDF *f = isect.f;
+        Vector const wi = -1.f * r.dir;
+        // normal do lado de onde o fotão chega
+        Vector n = isect.sn;
+        if (n.dot(wi) < 0.f) n = -1.f * n;
+
+        if (depth > 0 && !f->Kd.isZero()) {
+            Photon ph = {isect.p, power, wi, n, 0};
+            out.push_back(ph);
+        }
+
+        float pdf[3];
+        pdf[0] = f->Ks.Y();
+        pdf[1] = f->Kt.Y();
+        pdf[2] = (diffuse < maxDiffuse) ? f->Kd.Y() : 0.f;
+        float const sum = pdf[0] + pdf[1] + pdf[2];
+        if (sum <= 0.f) return;
+        float const u = rng.UniformFloat() * sum;
+
+        if (u < pdf[0]) {
+            power = power * f->Ks * (sum / pdf[0]);
+            r = Ray(isect.p, reflect(wi, n), SPEC_REFL);
+            r.adjustOrigin(n);
+        }
+        else if (u < pdf[0] + pdf[1]) {
+            // entra no objeto se vem do ar, senão sai para o ar
+            float const new_eta = (eta == 1.f) ? f->eta : 1.f;
+            float const IOR = eta / new_eta;
+            float const cos_theta = std::min(n.dot(wi), 1.f);
+            float const sin_theta = sqrtf(std::max(0.f, 1.f - cos_theta * cos_theta));
+            bool const cannot_refract = (IOR * sin_theta > 1.f);
+
+            power = power * f->Kt * (sum / pdf[1]);
+            if (cannot_refract) {
+                r = Ray(isect.p, reflect(wi, n), SPEC_REFL);
+                r.adjustOrigin(n);
+            }
+            else {
+                r = Ray(isect.p, refract(r.dir, n, IOR), SPEC_TRANS);
+                r.adjustOrigin(-1.f * n);
+                eta = new_eta;
+            }
+        }
+        else {
+            // difuso, amostrado pelo coseno: f cos / pdf = Kd pi
+            float rnd[2] = {rng.UniformFloat(), rng.UniformFloat()};
+            Vector D_around_Z, Rx, Ry;
+            CosineHemiSphereSample(rnd, D_around_Z);
+            n.CoordinateSystem(&Rx, &Ry);
+            power = power * f->Kd * ((float)M_PI * sum / pdf[2]);
+            r = Ray(isect.p, D_around_Z.Rotate(Rx, Ry, n), DIFF_REFL);
+            r.adjustOrigin(n);
+            diffuse++;
+        }
+    }
+}
+
+void PhotonMap::Emit (Scene *scene, int const nPhotons, int const maxDiffuse, unsigned int const seed, int nThreads) {
+    photons.clear();
+
+    // escolha das luzes pelo fluxo
+    int const nL = (int)scene->lights.size();
+    std::vector<RGB> flux(nL);
+    std::vector<float> cdf(nL);
+    float sum = 0.f;
+    for (int l = 0; l < nL; l++) {
+        flux[l] = LightFlux(scene->lights[l]);
+        sum += flux[l].Y();
+        cdf[l] = sum;
+    }
+    if (sum <= 0.f || nPhotons <= 0) return;
+
+    if (nThreads <= 0) nThreads = (int)std::thread::hardware_concurrency();
+    if (nThreads <= 0) nThreads = 1;
+
+    // cada thread traça um intervalo de fotões; cada fotão tem a sua sequência do PCG32,
+    // por isso o mapa não depende do número de threads
+    std::vector<std::vector<Photon>> stored(nThreads);
+    auto worker = [&](int const t) {
+        int const i0 = (int)((long)nPhotons * t / nThreads);
+        int const i1 = (int)((long)nPhotons * (t + 1) / nThreads);
+        PCG32 rng;
+        for (int i = i0; i < i1; i++) {
+            rng.SetSequence(((uint64_t)seed << 32) | (uint64_t)i);
+            float const u = rng.UniformFloat() * sum;
+            int const l = std::min((int)(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), nL - 1);
+            float const pdf = flux[l].Y() / sum;
+            Ray r;
+            if (pdf <= 0.f || !EmitRay(scene->lights[l], rng, &r)) continue;
+            TracePhoton(scene, r, flux[l] / (pdf * nPhotons), maxDiffuse, rng, stored[t]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < nThreads; t++) pool.push_back(std::thread(worker, t));
+    worker(0);
+    for (auto &t : pool) t.join();
+
+    for (auto const& s : stored) photons.insert(photons.end(), s.begin(), s.end());
+    build(photons, 0, (int)photons.size());
+
+    // irradiância pré-calculada, repartida pelos threads
+    int const nIrr = ((int)photons.size() + PRECOMPUTE_STRIDE - 1) / PRECOMPUTE_STRIDE;
+    irradiance.resize(nIrr);
+    auto precompute = [&](int const t) {
+        for (int i = t; i < nIrr; i += nThreads) {
+            Photon ip = photons[i * PRECOMPUTE_STRIDE];
+            ip.power = Estimate(ip.p, ip.n);
+            irradiance[i] = ip;
+        }
+    };
+    pool.clear();
+    for (int t = 1; t < nThreads; t++) pool.push_back(std::thread(precompute, t));
+    precompute(0);
+    for (auto &t : pool) t.join();
+    build(irradiance, 0, nIrr);
+}
+
+void PhotonMap::build (std::vector<Photon>& tree, int lo, int hi) {
+    if (hi - lo <= 0) return;
+    // eixo de maior extensão dos fotões do intervalo
+    Point pmin = tree[lo].p, pmax = tree[lo].p;
+    for (int i = lo + 1; i < hi; i++) {
+        Point const& p = tree[i].p;
+        pmin.X = std::min(pmin.X, p.X); pmax.X = std::max(pmax.X, p.X);
+        pmin.Y = std::min(pmin.Y, p.Y); pmax.Y = std::max(pmax.Y, p.Y);
+        pmin.Z = std::min(pmin.Z, p.Z); pmax.Z = std::max(pmax.Z, p.Z);
+    }
+    float const dx = pmax.X - pmin.X, dy = pmax.Y - pmin.Y, dz = pmax.Z - pmin.Z;
+    int const axis = (dx >= dy && dx >= dz) ? 0 : ((dy >= dz) ? 1 : 2);
+
+    int const mid = (lo + hi) / 2;
+    std::nth_element(tree.begin() + lo, tree.begin() + mid, tree.begin() + hi,
+                     [axis](Photon const& a, Photon const& b) { return Coord(a.p, axis) < Coord(b.p, axis); });
+    tree[mid].axis = axis;
+    build(tree, lo, mid);
+    build(tree, mid + 1, hi);
+}
+
+void PhotonMap::locate (Point const& p, int lo, int hi, std::vector<std::pair<float, int>>& heap, float *r2) const {
+    if (hi - lo <= 0) return;
+    int const mid = (lo + hi) / 2;
+    Photon const& ph = photons[mid];
+    float const d = Coord(p, ph.axis) - Coord(ph.p, ph.axis);
+
+    // primeiro o lado de p, depois o outro se o plano estiver dentro do raio atual
+    if (d < 0.f) locate(p, lo, mid, heap, r2);
+    else locate(p, mid + 1, hi, heap, r2);
+
+    Vector const v = ph.p.vec2point(p);
+    float const dist2 = v.X * v.X + v.Y * v.Y + v.Z * v.Z;
+    if (dist2 < *r2) {
+        if ((int)heap.size() == k) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+        }
+        heap.push_back(std::make_pair(dist2, mid));
+        std::push_heap(heap.begin(), heap.end());
+        // com k fotões o raio encolhe até ao mais afastado
+        if ((int)heap.size() == k) *r2 = heap.front().first;
+    }
+
+    if (d * d < *r2) {
+        if (d < 0.f) locate(p, mid + 1, hi, heap, r2);
+        else locate(p, lo, mid, heap, r2);
+    }
+}
+
+void PhotonMap::nearest (Point const& p, Vector const& n, int lo, int hi, int *best, float *r2) const {
+    if (hi - lo <= 0) return;
+    int const mid = (lo + hi) / 2;
+    Photon const& ip = irradiance[mid];
+    float const d = Coord(p, ip.axis) - Coord(ip.p, ip.axis);
+
+    if (d < 0.f) nearest(p, n, lo, mid, best, r2);
+    else nearest(p, n, mid + 1, hi, best, r2);
+
+    Vector const v = ip.p.vec2point(p);
+    float const dist2 = v.X * v.X + v.Y * v.Y + v.Z * v.Z;
+    if (dist2 < *r2 && ip.n.dot(n) >= MIN_NORMAL_COS) {
+        *best = mid;
+        *r2 = dist2;
+    }
+
+    if (d * d < *r2) {
+        if (d < 0.f) nearest(p, n, mid + 1, hi, best, r2);
+        else nearest(p, n, lo, mid, best, r2);
+    }
+}
+
+RGB PhotonMap::Estimate (Point const& p, Vector const& n) const {
+    static thread_local std::vector<std::pair<float, int>> heap;
+    heap.clear();
+    float r2 = maxRadius2;
+    locate(p, 0, (int)photons.size(), heap, &r2);
+    if (heap.empty()) return RGB(0., 0., 0.);
+
+    // só os fotões que chegam pelo lado da normal
+    RGB flux(0., 0., 0.);
+    for (auto const& h : heap) {
+        Photon const& ph = photons[h.second];
+        if (ph.wi.dot(n) > 0.f) flux += ph.power;
+    }
+    // densidade no disco de raio r (o do k-ésimo fotão, ou o máximo se há menos de k)
+    return flux / ((float)M_PI * r2);
+}
+
+RGB PhotonMap::Radiance (Point const& p, Vector const& n, RGB Kd) const {
+    if (photons.empty() || Kd.isZero()) return RGB(0., 0., 0.);
+
+    int best = -1;
+    float r2 = maxRadius2;
+    nearest(p, n, 0, (int)irradiance.size(), &best, &r2);
+    // sem ponto pré-calculado próximo (e.g., zonas com poucos fotões): estimativa completa
+    RGB const E = (best >= 0) ? irradiance[best].power : Estimate(p, n);
+    return Kd * E;
+}
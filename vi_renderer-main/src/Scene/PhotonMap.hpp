@@ -0,0 +1,64 @@
+//
+//  PhotonMap.hpp
+//  VI-RT
+//
+//  Mapa de fotões (Jensen 1996, "Global Illumination using Photon Maps") para a
+//  iluminação indireta difusa: os fotões são traçados a partir das luzes uma única vez
+//  e guardados nas superfícies difusas onde chegam depois de pelo menos um ressalto
+//  (a iluminação direta continua a ser amostrada nas luzes).
+//  A irradiância estima-se a partir dos k fotões mais próximos, encontrados num kd-tree;
+//  para que cada consulta custe menos que um ressalto traçado, é pré-calculada numa
+//  fração dos fotões (Christensen 1999, "Faster Photon Map Global Illumination") e
+//  a radiância refletida num ponto usa a do ponto pré-calculado mais próximo com a
+//  mesma orientação: os mesmos valores servem todos os pixeis e todos os frames.
+//  Convenções da iluminação direta: radiância das luzes de área = intensity, BRDF difusa = Kd.
+//
+
+#ifndef PhotonMap_hpp
+#define PhotonMap_hpp
+
+#include "vector.hpp"
+#include "RGB.hpp"
+#include <vector>
+
+class Scene;
+
+typedef struct Photon {
+    Point p;
+    RGB power;      // fluxo transportado pelo fotão (pontos pré-calculados: irradiância)
+    Vector wi;      // direção de onde o fotão veio (normalizada)
+    Vector n;       // normal da superfície, do lado de onde o fotão veio
+    int axis;       // eixo de divisão do nó do kd-tree (0, 1, 2 = X, Y, Z)
+} Photon;
+
+// kd-tree implícito: em cada intervalo [lo,hi[ o nó é o fotão mediano, no meio,
+// e os filhos são os intervalos [lo,mid[ e [mid+1,hi[
+class PhotonMap {
+    std::vector<Photon> photons;
+    std::vector<Photon> irradiance;     // pontos com a irradiância pré-calculada
+    int k;                  // fotões por estimativa
+    float maxRadius2;       // quadrado do raio máximo de procura
+
+    static void build (std::vector<Photon>& tree, int lo, int hi);
+    // os até k fotões mais próximos de p, num max-heap de (distância^2, índice)
+    void locate (Point const& p, int lo, int hi, std::vector<std::pair<float, int>>& heap, float *r2) const;
+    // o ponto pré-calculado mais próximo de p com normal próxima de n (-1 se nenhum dentro de r2)
+    void nearest (Point const& p, Vector const& n, int lo, int hi, int *best, float *r2) const;
+    // irradiância em p (normal n) a partir dos k fotões mais próximos
+    RGB Estimate (Point const& p, Vector const& n) const;
+public:
+    PhotonMap (int const k, float const maxRadius): k(k), maxRadius2(maxRadius * maxRadius) {}
+
+    // traça nPhotons fotões a partir das luzes pontuais e de área (escolhidas pelo fluxo),
+    // com até maxDiffuse ressaltos difusos (os especulares não contam), e constrói o kd-tree
+    // nThreads = 0 : std::thread::hardware_concurrency() ; o resultado não depende de nThreads
+    // pré-calcula a irradiância em 1 de cada PRECOMPUTE_STRIDE fotões
+    void Emit (Scene *scene, int const nPhotons, int const maxDiffuse, unsigned int const seed = 0, int nThreads = 0);
+
+    // radiância refletida em p (normal n, virada para o observador) por uma superfície difusa Kd
+    RGB Radiance (Point const& p, Vector const& n, RGB Kd) const;
+
+    int Count () const { return (int)photons.size(); }
+};
+
+#endif /* PhotonMap_hpp */
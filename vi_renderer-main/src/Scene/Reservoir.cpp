@@ -0,0 +1,15 @@
+//
+//  Reservoir.cpp
+//  VI-RT
+//
+
+#include "Reservoir.hpp"
+
+ReservoirBuffer::ReservoirBuffer (int const _W, int const _H, bool const _temporal, bool const _spatial):
+    W(_W), H(_H), curr(_W * _H), prev(_W * _H),
+    temporal(_temporal), spatial(_spatial), spatialSamples(4), spatialRadius(8), maxHistory(20.f) {}
+
+void ReservoirBuffer::NextFrame () {
+    curr.swap(prev);
+    for (Reservoir& r : curr) r = Reservoir();
+}
@@ -0,0 +1,83 @@
+//
+//  Reservoir.hpp
+//  VI-RT
+//
+//  Reservoirs para reamostragem por importância (RIS) da iluminação direta,
+//  com reutilização temporal e espacial ao estilo ReSTIR (Bitterli et al. 2020,
+//  "Spatiotemporal reservoir resampling for real-time ray tracing with dynamic
+//  direct lighting")
+//  Um reservoir guarda uma única amostra de luz (índice da luz e ponto na luz)
+//  escolhida de um fluxo de candidatos com probabilidade proporcional ao seu peso
+//
+
+#ifndef Reservoir_hpp
+#define Reservoir_hpp
+
+#include "vector.hpp"
+#include <vector>
+
+typedef struct Reservoir {
+    int light;      // índice em Scene::lights da amostra escolhida ; -1 = vazio
+    Point Lpos;     // ponto amostrado na luz
+    float wSum;     // soma dos pesos dos candidatos vistos
+    float M;        // número de candidatos vistos
+    float W;        // peso da amostra escolhida: wSum / (M * p^(amostra))
+    Point p;        // ponto de shading e normal onde foi construído (validação da reutilização)
+    Vector n;
+
+    Reservoir (): light(-1), wSum(0.f), M(0.f), W(0.f) {}
+
+    // junta um candidato de peso w ; u é um número aleatório em [0,1[
+    bool Update (int const l, Point const& pos, float const w, float const u) {
+        wSum += w;
+        M += 1.f;
+        if (w > 0.f && u * wSum < w) {
+            light = l;
+            Lpos = pos;
+            return true;
+        }
+        return false;
+    }
+    // junta outro reservoir q, cuja amostra tem densidade alvo phat no ponto atual
+    bool Merge (Reservoir const& q, float const phat, float const u) {
+        float const w = phat * q.W * q.M;
+        wSum += w;
+        M += q.M;
+        if (w > 0.f && u * wSum < w) {
+            light = q.light;
+            Lpos = q.Lpos;
+            return true;
+        }
+        return false;
+    }
+} Reservoir;
+
+// um reservoir por pixel, para os hits primários
+// durante uma frame (um Render()) escreve-se no plano atual e lê-se do anterior,
+// por isso o resultado não depende da ordem pela qual os pixeis são processados
+class ReservoirBuffer {
+    int W, H;
+    std::vector<Reservoir> curr, prev;
+public:
+    bool temporal;      // reutiliza o reservoir do mesmo pixel (amostras e frames anteriores)
+    bool spatial;       // reutiliza os reservoirs de pixeis vizinhos da frame anterior
+    int spatialSamples; // número de vizinhos
+    int spatialRadius;  // em pixeis
+    float maxHistory;   // limite do histórico (M) de um reservoir reutilizado, em múltiplos do nº de candidatos novos
+
+    ReservoirBuffer (int const W, int const H, bool const temporal = true, bool const spatial = true);
+
+    // começo de uma frame: o plano atual passa a anterior e o atual é limpo
+    void NextFrame ();
+
+    Reservoir *Current (int const x, int const y) {
+        if (x < 0 || y < 0 || x >= W || y >= H) return nullptr;
+        return &curr[y * W + x];
+    }
+    Reservoir const *Previous (int const x, int const y) const {
+        if (x < 0 || y < 0 || x >= W || y >= H) return nullptr;
+        return &prev[y * W + x];
+    }
+};
+
+#endif /* Reservoir_hpp */
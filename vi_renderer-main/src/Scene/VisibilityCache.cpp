@@ -0,0 +1,89 @@
+//
+//  VisibilityCache.cpp
+//  VI-RT
+//
+
+#include "VisibilityCache.hpp"
+#include <math.h>
+
+// número máximo de slots visitados à procura de uma célula (sondagem linear)
+#define MAX_PROBES 16
+
+VisibilityCache::VisibilityCache (int const _nLights, Point const& _origin, float const _cellSize, int const _nSlots):
+    nLights(_nLights), cellSize(_cellSize), origin(_origin), used(0) {
+    // arredondar o número de slots para uma potência de 2
+    nSlots = 1;
+    while (nSlots < _nSlots) nSlots <<= 1;
+
+    long const n = (long)nSlots * nLights;
+    keys.reset(new std::atomic<uint64_t>[nSlots]);
+    tests.reset(new std::atomic<uint32_t>[n]);
+    hits.reset(new std::atomic<uint32_t>[n]);
+    for (int s = 0; s < nSlots; s++) keys[s].store(0, std::memory_order_relaxed);
+    for (long i = 0; i < n; i++) {
+        tests[i].store(0, std::memory_order_relaxed);
+        hits[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// coordenadas inteiras da célula, 21 bits cada ; o bit 63 distingue uma chave de um slot livre
+uint64_t VisibilityCache::Key (Point const& p) const {
+    uint64_t const ix = (uint64_t)(int64_t)floorf((p.X - origin.X) / cellSize) & 0x1FFFFF;
+    uint64_t const iy = (uint64_t)(int64_t)floorf((p.Y - origin.Y) / cellSize) & 0x1FFFFF;
+    uint64_t const iz = (uint64_t)(int64_t)floorf((p.Z - origin.Z) / cellSize) & 0x1FFFFF;
+    return (1ull << 63) | (ix << 42) | (iy << 21) | iz;
+}
+
+// finalizador do splitmix64
+static inline uint64_t HashKey (uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+int VisibilityCache::Slot (Point const& p, bool const insert) {
+    uint64_t const key = Key(p);
+    int s = (int)(HashKey(key) & (uint64_t)(nSlots - 1));
+
+    for (int probe = 0; probe < MAX_PROBES; probe++, s = (s + 1) & (nSlots - 1)) {
+        uint64_t k = keys[s].load(std::memory_order_acquire);
+        if (k == key) return s;
+        if (k == 0) {
+            if (!insert) return -1;
+            // ocupar o slot ; se outro thread o ocupou entretanto, pode ter sido com esta célula
+            if (keys[s].compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+                used++;
+                return s;
+            }
+            if (k == key) return s;
+        }
+    }
+    return -1;
+}
+
+float VisibilityCache::Visibility (Point const& p, int const l) {
+    int const s = Slot(p, false);
+    if (s < 0) return 0.5f;
+    long const i = (long)s * nLights + l;
+    return (hits[i].load(std::memory_order_relaxed) + 1.f) / (tests[i].load(std::memory_order_relaxed) + 2.f);
+}
+
+void VisibilityCache::Visibilities (Point const& p, float *v) {
+    int const s = Slot(p, false);
+    if (s < 0) {
+        for (int l = 0; l < nLights; l++) v[l] = 0.5f;
+        return;
+    }
+    long const i0 = (long)s * nLights;
+    for (int l = 0; l < nLights; l++) {
+        v[l] = (hits[i0 + l].load(std::memory_order_relaxed) + 1.f) / (tests[i0 + l].load(std::memory_order_relaxed) + 2.f);
+    }
+}
+
+void VisibilityCache::Record (Point const& p, int const l, bool const visible) {
+    int const s = Slot(p, true);
+    if (s < 0) return;
+    long const i = (long)s * nLights + l;
+    tests[i].fetch_add(1, std::memory_order_relaxed);
+    if (visible) hits[i].fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,56 @@
+//
+//  VisibilityCache.hpp
+//  VI-RT
+//
+//  Cache de visibilidade das luzes: uma grelha regular sobre o espaço do mundo,
+//  guardada numa tabela de hash (só as células onde houve pontos de shading ocupam
+//  um slot), que regista, para cada célula e cada luz, quantos shadow rays foram
+//  traçados e quantos chegaram à luz.
+//  A visibilidade estimada, (sucessos+1)/(testes+2), é usada pela iluminação direta
+//  para escolher as luzes (modo VISIBILITY) ou decidir por roleta russa se vale a
+//  pena traçar o shadow ray (ALL_LIGHTS), sem enviesar o resultado: nenhuma luz
+//  fica com probabilidade nula.
+//  A cache aprende durante o render e é partilhada pelos threads (contadores atómicos).
+//  Por isso a escolha das luzes depende da ordem pela qual os threads registam os seus
+//  shadow rays: com a cache, a mesma seed já não garante a mesma imagem.
+//  Memória: nSlots * #luzes * 8 bytes, adequada a cenas com dezenas de luzes.
+//
+
+#ifndef VisibilityCache_hpp
+#define VisibilityCache_hpp
+
+#include "vector.hpp"
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+class VisibilityCache {
+    int nLights;
+    int nSlots;         // potência de 2
+    float cellSize;
+    Point origin;       // canto da célula (0,0,0)
+    std::unique_ptr<std::atomic<uint64_t>[]> keys;     // célula de cada slot ; 0 = livre
+    std::unique_ptr<std::atomic<uint32_t>[]> tests;    // por (slot, luz)
+    std::unique_ptr<std::atomic<uint32_t>[]> hits;
+    std::atomic<int> used;
+
+    uint64_t Key (Point const& p) const;
+    // slot da célula que contém p ; com insert ocupa um slot livre se a célula ainda não existir
+    // -1 se a célula não existe (ou a tabela está cheia nessa zona)
+    int Slot (Point const& p, bool const insert);
+public:
+    VisibilityCache (int const nLights, Point const& origin, float const cellSize, int const nSlots);
+
+    // probabilidade estimada de um shadow ray a partir de p chegar à luz l
+    float Visibility (Point const& p, int const l);
+    // o mesmo para todas as luzes, em v[0..#luzes[
+    void Visibilities (Point const& p, float *v);
+    // regista o resultado de um shadow ray a partir de p para a luz l
+    void Record (Point const& p, int const l, bool const visible);
+
+    int Cells () const { return used; }
+    int Slots () const { return nSlots; }
+    float CellSize () const { return cellSize; }
+};
+
+#endif /* VisibilityCache_hpp */
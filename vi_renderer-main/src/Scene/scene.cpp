@@ -12,46 +12,78 @@
 #include "AreaLight.hpp"
 
 #include <iostream>
+#include <algorithm>
 #include <set>
 #include <vector>
 
 Scene::~Scene() {
     if (bvh) delete bvh;
     if (lightBVH) delete lightBVH;
+    if (lightDistribution) delete lightDistribution;
+    if (lightTree) delete lightTree;
+    if (reservoirs) delete reservoirs;
+    if (visibilityCache) delete visibilityCache;
+    if (photonMap) delete photonMap;
     for (auto prim : lightPrims) {
         delete prim;
     }
 }
 
-void Scene::BuildBVH() {
+void Scene::BuildBVH(BVHLayout layout, bool withLights) {
     if (prims.size() > 0) {
-        bvh = new BVHAccel(prims, BRDFs.data(), 4, SplitMethod::SAH);
+        std::vector<Primitive*> bvhPrims(prims);
+        int areaLightCount = 0;
+        if (withLights) {
+            // emissores como primitivas marcadas com o índice da luz
+            areaLightCount = CreateLightPrimitives();
+            bvhPrims.insert(bvhPrims.end(), lightPrims.begin(), lightPrims.end());
+        }
+        
+        bvh = new BVHAccel(bvhPrims, BRDFs.data(), 4, SplitMethod::SAH, layout);
+        bvh->printStats();
         useBVH = true;
+        lightsInBVH = (areaLightCount > 0);
         fprintf(stdout, "BVH acceleration enabled\n");
         fprintf(stdout, "Total primitives in scene: %zu\n", prims.size());
+        if (lightsInBVH) {
+            fprintf(stdout, "Area lights in scene BVH: %d\n", areaLightCount);
+        }
     }
 }
 
-void Scene::BuildLightBVH() {
+// Cria uma primitiva por area light, que aponta para a geometria da luz
+// e guarda o seu índice em lights; devolve o nº de area lights
+int Scene::CreateLightPrimitives() {
+    for (auto prim : lightPrims) {
+        delete prim;
+    }
     lightPrims.clear();
-    geometryToLight.clear();
     
     int areaLightCount = 0;
-    for (auto l : lights) {
-        if (l->type == AREA_LIGHT) {
-            AreaLight* al = (AreaLight*)l;
-            geometryToLight[al->gem] = al;
-            
+    for (size_t l = 0; l < lights.size(); l++) {
+        if (lights[l]->type == AREA_LIGHT) {
+            AreaLight* al = (AreaLight*)lights[l];
             // Criar uma primitiva que aponta para a geometria da luz
             Primitive* lightPrim = new Primitive;
             lightPrim->g = al->gem;
             
             lightPrim->material_ndx = -1;
+            lightPrim->light_ndx = (int)l;
 
             lightPrims.push_back(lightPrim);
             areaLightCount++;
         }
     }
+    return areaLightCount;
+}
+
+void Scene::BuildLightBVH() {
+    if (lightsInBVH) {
+        fprintf(stdout, "Area lights are in the scene BVH, Light BVH not built\n");
+        return;
+    }
+    
+    int const areaLightCount = CreateLightPrimitives();
     
     if (areaLightCount > 0) {
         fprintf(stdout, "Building Light BVH with %d area lights...\n", areaLightCount);
@@ -66,12 +98,122 @@ void Scene::BuildLightBVH() {
     }
 }
 
+void Scene::BuildLightDistribution() {
+    if (lightDistribution) delete lightDistribution;
+    lightDistribution = new LightDistribution(lights);
+    fprintf(stdout, "Light distribution: %d lights sampled by power, %zu ambient\n",
+            lightDistribution->Count(), lightDistribution->AmbientLights().size());
+}
+
+void Scene::BuildLightTree() {
+    if (lightTree) delete lightTree;
+    lightTree = new LightTree(lights);
+    fprintf(stdout, "Light tree: %d lights sampled by estimated contribution, %zu ambient\n",
+            lightTree->Count(), lightTree->AmbientLights().size());
+}
+
+void Scene::BuildReservoirBuffer(int const W, int const H, bool const temporal, bool const spatial) {
+    if (reservoirs) delete reservoirs;
+    reservoirs = new ReservoirBuffer(W, H, temporal, spatial);
+    fprintf(stdout, "Reservoir buffer: %dx%d, temporal reuse %s, spatial reuse %s\n",
+            W, H, temporal ? "on" : "off", spatial ? "on" : "off");
+}
+
+// limites da cena (primitivas e luzes de área)
+BB Scene::Bounds() {
+    BB bounds = {Point(MAXFLOAT, MAXFLOAT, MAXFLOAT), Point(-MAXFLOAT, -MAXFLOAT, -MAXFLOAT)};
+    std::vector<BB> boxes;
+    for (auto prim : prims) boxes.push_back(prim->g->WorldBound());
+    for (auto l : lights) {
+        if (l->type == AREA_LIGHT) boxes.push_back(((AreaLight *)l)->gem->WorldBound());
+    }
+    for (BB const& b : boxes) {
+        bounds.min.X = std::min(bounds.min.X, b.min.X);
+        bounds.min.Y = std::min(bounds.min.Y, b.min.Y);
+        bounds.min.Z = std::min(bounds.min.Z, b.min.Z);
+        bounds.max.X = std::max(bounds.max.X, b.max.X);
+        bounds.max.Y = std::max(bounds.max.Y, b.max.Y);
+        bounds.max.Z = std::max(bounds.max.Z, b.max.Z);
+    }
+    if (boxes.empty()) bounds.min = bounds.max = Point(0., 0., 0.);
+    return bounds;
+}
+
+void Scene::BuildVisibilityCache(float cellSize, int const nSlots) {
+    if (visibilityCache) delete visibilityCache;
+    BB const bounds = Bounds();
+    if (cellSize <= 0.f) {
+        float const diag = bounds.min.vec2point(bounds.max).norm();
+        cellSize = (diag > 0.f) ? diag / 64.f : 1.f;
+    }
+    visibilityCache = new VisibilityCache(numLights, bounds.min, cellSize, nSlots);
+    fprintf(stdout, "Visibility cache: %d lights, cells of %g, %d slots (%.1f MB)\n", numLights, cellSize,
+            visibilityCache->Slots(), visibilityCache->Slots() * (8. + 8. * numLights) / (1024. * 1024.));
+}
+
+void Scene::BuildPhotonMap(int const nPhotons, int const maxDiffuse, int const k, float maxRadius) {
+    if (photonMap) delete photonMap;
+    if (maxRadius <= 0.f) {
+        BB const bounds = Bounds();
+        float const diag = bounds.min.vec2point(bounds.max).norm();
+        maxRadius = (diag > 0.f) ? diag / 50.f : 1.f;
+    }
+    photonMap = new PhotonMap(k, maxRadius);
+    photonMap->Emit(this, nPhotons, maxDiffuse);
+    fprintf(stdout, "Photon map: %d photons emitted, %d stored, %d per estimate within %g\n",
+            nPhotons, photonMap->Count(), k, maxRadius);
+}
+
+// Interseção com as fontes de luz (area lights); intersection indica se isect
+// já contém um hit numa superfície, que é substituído se a luz estiver mais perto
+// (r.tMax já foi encurtado até esse hit, por isso só são encontradas luzes mais próximas)
+bool Scene::traceLights(Ray& r, Intersection *isect, bool intersection) {
+    Intersection curr_isect;
+    curr_isect.pix_x = r.pix_x;
+    curr_isect.pix_y = r.pix_y;
+    
+    isect->isLight = false;
+    
+    if (useLightBVH && lightBVH) {
+        Intersection light_isect;
+        light_isect.pix_x = r.pix_x;
+        light_isect.pix_y = r.pix_y;
+        
+        // as primitivas das luzes guardam o índice da luz (CreateLightPrimitives)
+        if (lightBVH->Intersect(r, &light_isect)) {
+            intersection = true;
+            *isect = light_isect;
+            isect->Le = lights[light_isect.light_ndx]->L();
+        }
+    }
+    else {
+        // Fallback: força bruta para luzes quando Light BVH não está disponível
+        for (auto l = lights.begin(); l != lights.end(); l++) {
+            if ((*l)->type == AREA_LIGHT) {
+                AreaLight *al = (AreaLight *)*l;
+                if (al->gem->intersect(r, &curr_isect)) {
+                    // está mais perto que o hit anterior (r.tMax)
+                    intersection = true;
+                    r.tMax = curr_isect.depth;
+                    *isect = curr_isect;
+                    isect->isLight = true;
+                    isect->Le = al->L();
+                    isect->light_ndx = (int)(l - lights.begin());
+                }
+            }
+        }
+    }
+    
+    return intersection;
+}
+
 bool Scene::trace(Ray r, Intersection *isect) {
     Intersection curr_isect;
     bool intersection = false;    
-    static int total_traces = 0;
-    static int bvh_hits = 0;
-    static int light_hits = 0;
+    // per thread counters (the renderer may call trace() from several threads)
+    static thread_local int total_traces = 0;
+    static thread_local int bvh_hits = 0;
+    static thread_local int light_hits = 0;
 
     total_traces++;
     
@@ -83,79 +225,30 @@ bool Scene::trace(Ray r, Intersection *isect) {
     // USA BVH PARA TRACE
     if (useBVH && bvh) {
         // BVH agora já atribui o material internamente
+        // e encurta r.tMax até ao hit mais próximo
         intersection = bvh->Intersect(r, isect);
         if (intersection) bvh_hits++;
     }
     else {
         // FORÇA BRUTA apenas quando BVH não está disponível
         for (auto prim_itr = prims.begin(); prim_itr != prims.end(); prim_itr++) {
+            // só são reportados hits mais próximos que r.tMax
             if ((*prim_itr)->g->intersect(r, &curr_isect)) {
-                if (!intersection) {
-                    intersection = true;
-                    *isect = curr_isect;
-                    isect->f = BRDFs[(*prim_itr)->material_ndx];
-                }
-                else if (curr_isect.depth < isect->depth) {
-                    *isect = curr_isect;
-                    isect->f = BRDFs[(*prim_itr)->material_ndx];
-                }
+                intersection = true;
+                r.tMax = curr_isect.depth;
+                *isect = curr_isect;
+                isect->f = BRDFs[(*prim_itr)->material_ndx];
             }
         }
     }
     
     // LUZES
-    isect->isLight = false;
-    
-    if (useLightBVH && lightBVH) {
-        Intersection light_isect;
-        light_isect.pix_x = r.pix_x;
-        light_isect.pix_y = r.pix_y;
-        
-        if (lightBVH->Intersect(r, &light_isect)) {
-            if (!intersection || light_isect.depth < isect->depth) {
-                // Método mais eficiente: percorrer as primitivas das luzes e verificar qual geometria foi atingida
-                for (size_t i = 0; i < lightPrims.size(); i++) {
-                    // Testar se este triângulo específico foi atingido
-                    // fazendo uma intersecção precisa
-                    Intersection test_isect;
-                    if (lightPrims[i]->g->intersect(r, &test_isect)) {
-                        // Verificar se é a mesma intersecção (mesma profundidade)
-                        if (std::abs(test_isect.depth - light_isect.depth) < EPSILON) {
-                            // Encontrou! Buscar a luz correspondente
-                            auto it = geometryToLight.find(lightPrims[i]->g);
-                            if (it != geometryToLight.end()) {
-                                intersection = true;
-                                *isect = light_isect;
-                                isect->isLight = true;
-                                isect->Le = it->second->L();
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    else {
-        // Fallback: força bruta para luzes quando Light BVH não está disponível
-        for (auto l = lights.begin(); l != lights.end(); l++) {
-            if ((*l)->type == AREA_LIGHT) {
-                AreaLight *al = (AreaLight *)*l;
-                if (al->gem->intersect(r, &curr_isect)) {
-                    if (!intersection) {
-                        intersection = true;
-                        *isect = curr_isect;
-                        isect->isLight = true;
-                        isect->Le = al->L();
-                    }
-                    else if (curr_isect.depth < isect->depth) {
-                        *isect = curr_isect;
-                        isect->isLight = true;
-                        isect->Le = al->L();
-                    }
-                }
-            }
-        }
+    if (lightsInBVH) {
+        // as luzes estão no BVH: isect já indica se o hit mais próximo é um emissor
+        if (!intersection) isect->isLight = false;
+        else if (isect->isLight) isect->Le = lights[isect->light_ndx]->L();
+    } else {
+        intersection = traceLights(r, isect, intersection);
     }
     
     isect->r_type = r.rtype;
@@ -167,12 +260,48 @@ bool Scene::trace(Ray r, Intersection *isect) {
     return intersection;
 }
 
+// Traça um pacote de raios coerentes (e.g., as amostras de um pixel)
+// devolve a máscara dos raios que intersetaram algo
+int Scene::trace4(RayPacket& packet, Intersection *isect) {
+    int hits = 0;
+    
+    // sem BVH: raio a raio
+    if (numPrimitives == 0 || !useBVH || !bvh) {
+        for (int i = 0; i < packet.n; i++) {
+            if (trace(packet.rays[i], &isect[i])) hits |= 1 << i;
+        }
+        return hits;
+    }
+    
+    for (int i = 0; i < packet.n; i++) {
+        isect[i].pix_x = packet.rays[i].pix_x;
+        isect[i].pix_y = packet.rays[i].pix_y;
+    }
+    int const bvhHits = bvh->Intersect4(packet, isect);
+    
+    for (int i = 0; i < packet.n; i++) {
+        bool intersection = (bvhHits & (1 << i)) != 0;
+        if (lightsInBVH) {
+            if (!intersection) isect[i].isLight = false;
+            else if (isect[i].isLight) isect[i].Le = lights[isect[i].light_ndx]->L();
+        } else {
+            intersection = traceLights(packet.rays[i], &isect[i], intersection);
+        }
+        isect[i].r_type = packet.rays[i].rtype;
+        if (intersection) hits |= 1 << i;
+    }
+    return hits;
+}
+
 bool Scene::visibility(Ray s, const float maxL) {
-    static int total_shadow_rays = 0;
-    static int bvh_shadow_rays = 0;
+    static thread_local int total_shadow_rays = 0;
+    static thread_local int bvh_shadow_rays = 0;
     
     total_shadow_rays++;
     
+    // só contam oclusores antes de maxL
+    s.tMax = std::min(s.tMax, maxL);
+    
     if (useBVH && bvh) {
         bvh_shadow_rays++;
         
@@ -182,16 +311,14 @@ bool Scene::visibility(Ray s, const float maxL) {
                     100.0f * bvh_shadow_rays / total_shadow_rays);
         }
         
-        return !bvh->IntersectP(s, maxL);
+        return !bvh->IntersectP(s);
     }
     if (numPrimitives == 0) return true;
     
     Intersection curr_isect;
     for (auto prim : prims) {
         if (prim->g->intersect(s, &curr_isect)) {
-            if (curr_isect.depth < maxL) {
-                return false;  
-            }
+            return false;
         }
     }
     return true; 
@@ -11,13 +11,18 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <map>
 #include "BVHAccel.hpp"
 #include "primitive.hpp"
 #include "light.hpp"
 #include "ray.hpp"
+#include "RayPacket.hpp"
 #include "intersection.hpp"
 #include "BRDF.hpp"
+#include "LightDistribution.hpp"
+#include "LightTree.hpp"
+#include "Reservoir.hpp"
+#include "VisibilityCache.hpp"
+#include "PhotonMap.hpp"
 
 class AreaLight;
 
@@ -29,19 +34,49 @@ class Scene {
     std::vector <Primitive *> lightPrims; 
     BVHAccel* lightBVH;                    
     bool useLightBVH;
-    std::map<Geometry*, AreaLight*> geometryToLight; 
+    bool lightsInBVH;     // area lights inserted in bvh as tagged primitives (no light pass)
+    int CreateLightPrimitives ();
+    BB Bounds ();          // of the primitives and area lights
+    bool traceLights (Ray& r, Intersection *isect, bool intersection);
 public:
     std::vector <Light *> lights;
     int numPrimitives, numLights, numBRDFs;
+    LightDistribution *lightDistribution;   // light selection by power ; see BuildLightDistribution
+    LightTree *lightTree;                   // light selection by estimated contribution ; see BuildLightTree
+    ReservoirBuffer *reservoirs;            // per pixel reservoirs for RESERVOIR reuse ; see BuildReservoirBuffer
+    VisibilityCache *visibilityCache;       // per cell light visibility for VISIBILITY / ALL_LIGHTS ; see BuildVisibilityCache
+    PhotonMap *photonMap;                   // indirect diffuse illumination for PathTracing ; see BuildPhotonMap
 
-    Scene() : numPrimitives(0), numLights(0), numBRDFs(0), 
+    Scene() : numPrimitives(0), numLights(0), numBRDFs(0), lightDistribution(nullptr), lightTree(nullptr), reservoirs(nullptr),
+              visibilityCache(nullptr), photonMap(nullptr),
               bvh(nullptr), useBVH(false), 
-              lightBVH(nullptr), useLightBVH(false) {}
+              lightBVH(nullptr), useLightBVH(false), lightsInBVH(false) {}
     ~Scene();
-    void BuildBVH();
+    // withLights : the area lights are added to the scene BVH, so that a single traversal
+    // finds either a surface or an emitter (BuildLightBVH is then not needed)
+    void BuildBVH(BVHLayout layout = BVHLayout::Binary, bool withLights = false);
     void BuildLightBVH();
+    // build the light power distribution (once all lights have been added)
+    void BuildLightDistribution();
+    // build the light tree (once all lights have been added)
+    void BuildLightTree();
+    // per pixel reservoirs, so that RESERVOIR direct lighting reuses light samples
+    // across samples / frames of a pixel (temporal) and from neighbouring pixels (spatial)
+    void BuildReservoirBuffer(int const W, int const H, bool const temporal = true, bool const spatial = true);
+    // light visibility cache over a grid of cellSize cells (0 = 1/64 of the scene's diagonal),
+    // stored in a hash table of nSlots cells (once all primitives and lights have been added)
+    // the cache learns while rendering, so VISIBILITY / ALL_LIGHTS images are not reproducible:
+    // they depend on the order in which the threads record their shadow rays
+    void BuildVisibilityCache(float cellSize = 0.f, int const nSlots = 1 << 14);
+    // photon map with nPhotons emitted photons and up to maxDiffuse diffuse bounces each;
+    // radiance estimates from the k nearest photons within maxRadius (0 = 1/50 of the scene's diagonal)
+    // (once the BVH has been built: photons are traced)
+    void BuildPhotonMap(int const nPhotons = 200000, int const maxDiffuse = 1, int const k = 64, float maxRadius = 0.f);
     bool SetLights (void) { return true; };
     bool trace (Ray r, Intersection *isect);
+    // trace a packet of coherent rays; isect must hold packet.n intersections
+    // returns the mask of rays that hit something
+    int trace4 (RayPacket& packet, Intersection *isect);
     bool visibility (Ray s, const float maxL);
     int AddMaterial (BRDF *mat) {
         BRDFs.push_back (mat);
@@ -11,9 +11,11 @@
 
 #include "Shader_Utils.hpp"
 
-RGB PathTracing::specularReflection (Intersection isect, BRDF *f, int depth) {
-    RGB color(0.,0.,0.);
+// Russian Roullette
+#define MIN_DEPTH 1
+#define P_CONTINUE 0.2f
 
+Ray PathTracing::specularReflection (Intersection const& isect) {
     // generate the specular ray
     // direction R = 2 (N.V) N - V
     Vector Rdir = reflect(isect.wo, isect.sn);
@@ -27,21 +29,10 @@ RGB PathTracing::specularReflection (Intersection isect, BRDF *f, int depth) {
     specular.adjustOrigin(isect.gn);
     specular.propagating_eta = isect.incident_eta;  // same medium
 
-    // OK, we have the ray : trace and shade it recursively
-    bool intersected;
-    Intersection s_isect;
-    // trace ray
-    intersected = scene->trace(specular, &s_isect);
-
-    // shade this intersection
-    color = f->Ks * shade (intersected, s_isect, depth+1);
-
-    return color;
+    return specular;
 }
 
-RGB PathTracing::specularTransmission (Intersection isect, BRDF *f, int depth) {
-    RGB color(0., 0., 0.);
-
+Ray PathTracing::specularTransmission (Intersection const& isect) {
     // generate the transmission ray
     // from https://raytracing.github.io/books/RayTracingInOneWeekend.html#dielectrics
     
@@ -84,30 +75,19 @@ RGB PathTracing::specularTransmission (Intersection isect, BRDF *f, int depth) {
     
     refraction.propagating_eta = (cannot_refract ? isect.incident_eta : new_eta);
 
-    // OK, we have the ray : trace and shade it recursively
-    bool intersected;
-    Intersection t_isect;
-    // trace ray
-    intersected = scene->trace(refraction, &t_isect);
-
-    // shade this intersection
-    color = f->Kt * shade (intersected, t_isect, depth+1);
-   
-    return color;
+    return refraction;
 }
 
-RGB PathTracing::diffuseReflection (Intersection isect, BRDF *f, int depth) {
-    RGB color(0.,0.,0.);
+Ray PathTracing::diffuseReflection (Intersection const& isect, BRDF *f, RGB *weight, float *dir_pdf) {
     Vector dir;
     float pdf;
     
-    // generate the specular ray
+    // generate the diffuse ray
     
     // actual direction distributed around N
     // get 2 random number in [0,1[
     float rnd[2];
-    rnd[0] = U_dist(rng);
-    rnd[1] = U_dist(rng);
+    sampler->Get2D(rnd);
         
     Vector D_around_Z;
     
@@ -138,88 +118,132 @@ RGB PathTracing::diffuseReflection (Intersection isect, BRDF *f, int depth) {
     diffuse.adjustOrigin(isect.sn);
     diffuse.propagating_eta = isect.incident_eta;  // same medium
 
-    // OK, we have the ray : trace and shade it recursively
-    bool intersected;
-    Intersection d_isect;
-    // trace ray
-    intersected = scene->trace(diffuse, &d_isect);
-
-    if (!d_isect.isLight) {  // if light source return 0 ; handled by direct
-        // shade this intersection
-        RGB Rcolor = shade (intersected, d_isect, depth+1);
-            
-        color = (f->Kd * cos_theta * Rcolor) / pdf ;
+    *weight = (f->Kd * cos_theta) / pdf;
+    // pdf of the whole BRDF (lobe selection included), for MIS
+    *dir_pdf = f->pdf(isect.wo.ToLocal(Rx, Ry, isect.sn), D_around_Z);
+    return diffuse;
+}
+
+bool PathTracing::Scatter (Intersection const& isect, int depth, Ray *next, RGB *weight, float *dir_pdf) {
+    BRDF *f = isect.f;
+
+    float cont = sampler->Get1D();
+    if (depth>=MIN_DEPTH && cont >= P_CONTINUE) return false;
+
+    float pdf[3], sum, cdf[3];
+
+    pdf[0] = f->Ks.Y(); //luminância
+    pdf[1] = f->Kt.Y();
+    // the photon map (if any) provides the indirect diffuse illumination
+    pdf[2] = scene->photonMap ? 0.f : f->Kd.Y();
+
+    sum = pdf[0] + pdf[1] + pdf[2];
+    if (sum <= 0.f) return false;
+
+    pdf[0] /= sum;
+    pdf[1] /= sum;
+    pdf[2] /= sum;
+
+    cdf[0] = pdf[0];
+    cdf[1] = pdf[0] + pdf[1];
+    cdf[2] = pdf[0] + pdf[1] + pdf[2];
+
+    float rnd = sampler->Get1D();
+
+    // if there is a specular component sample it
+    if (!f->Ks.isZero() && rnd < cdf[0]) {
+        *next = specularReflection (isect);
+        *weight = f->Ks / pdf[0];
+        *dir_pdf = 0.f;
     }
-    return color;
+    // if there is a transmission component sample it
+    else if (!f->Kt.isZero() && rnd < cdf[1]) {
+        *next = specularTransmission (isect);
+        *weight = f->Kt / pdf[1];
+        *dir_pdf = 0.f;
+    }
+    // if there is a diffuse component sample it
+    // do one bounce (do not continue on indirect diffuse)
+    else if (pdf[2] > 0.f && isect.r_type != DIFF_REFL) {
+        *next = diffuseReflection (isect, f, weight, dir_pdf);
+        *weight /= pdf[2];
+    }
+    else return false;
 
+    if (depth >= MIN_DEPTH)
+        *weight /= P_CONTINUE;
+    return true;
 }
 
-RGB PathTracing::shade(bool intersected, Intersection isect, int depth) {
-    RGB color(0.,0.,0.);
-    
+RGB PathTracing::Emitted (bool intersected, Intersection const& isect, float pdf, Point const& from, Vector const& fromN) {
     // if no intersection, return background
     if (!intersected) {
         return (background);
     }
-    if (isect.isLight) { // intersection with a light source
-        return isect.Le;
+    if (!isect.isLight) return RGB(0., 0., 0.);
+    // a light reached by a diffuse bounce was also sampled by direct lighting at the
+    // previous vertex: without MIS only that sample counts
+    if (isect.r_type == DIFF_REFL) {
+        return (MIS() ? directLightingMIS(scene, isect, pdf, lightSampling, from, fromN) : RGB(0., 0., 0.));
     }
-    // get the BRDF
-    BRDF *f = isect.f;
-    
-    // Russian Roullette
-    #define MIN_DEPTH 1
-    #define P_CONTINUE 0.2f
-
-    float cont = U_dist(rng);
-
-    if (depth<MIN_DEPTH || cont < P_CONTINUE) {
-        float pdf[3], sum, cdf[3];
-
-        pdf[0] = f->Ks.Y(); //luminância
-        pdf[1] = f->Kt.Y();
-        pdf[2] = f->Kd.Y();
-
-        sum = pdf[0] + pdf[1] + pdf[2];
-
-        pdf[0] /= sum;
-        pdf[1] /= sum;
-        pdf[2] /= sum;
+    return isect.Le;
+}
 
-        cdf[0] = pdf[0];
-        cdf[1] = pdf[0] + pdf[1];
-        cdf[2] = pdf[0] + pdf[1] + pdf[2];
+RGB PathTracing::DirectLighting (Intersection const& isect, Ray *shadow, float *maxL, RGB *Lcolor) {
+    // vertices reached by a diffuse bounce do not bounce diffusely (see Scatter):
+    // their light samples are the only way to reach the lights, so they are not weighted
+    // (nor are they with a photon map, as there are no diffuse bounces)
+    return directLightingDeferred(scene, isect, isect.f, sampler, shadow, maxL, Lcolor, lightSampling,
+                                  MIS() && isect.r_type != DIFF_REFL);
+}
 
-        float rnd = U_dist(rng);
+RGB PathTracing::IndirectDiffuse (Intersection const& isect) {
+    if (!scene->photonMap) return RGB(0., 0., 0.);
+    // the normal facing the viewer
+    Vector n = isect.sn;
+    if (n.dot(isect.wo) < 0.f) n = -1.f * n;
+    return scene->photonMap->Radiance(isect.p, n, isect.f->Kd);
+}
 
-            // if there is a specular component sample it
-        if (!f->Ks.isZero() && rnd < cdf[0]) {
-            RGB c_aux;
-            c_aux += specularReflection (isect, f, depth);
-            c_aux /= pdf[0];
-            color += c_aux;
-        }
-//         // if there is a specular component sample it
-        else if (!f->Kt.isZero() && rnd < cdf[1]) {
-            RGB c_aux;
-            c_aux += specularTransmission (isect, f, depth);
-            c_aux /= pdf[1];
-            color += c_aux;
+// the path is followed iteratively: each vertex adds its direct lighting weighted by the
+// throughput of the path so far (beta), which is then multiplied by the weight of the bounce
+RGB PathTracing::shade(bool intersected, Intersection isect, int depth) {
+    RGB color(0.,0.,0.), beta(1.,1.,1.);
+    float pdf = 0.f;   // of the direction that reached isect
+    Point from;        // and the vertex it left from (MIS)
+    Vector fromN;
+
+    for ( ; ; depth++) {
+        if (!intersected || isect.isLight) {
+            color += beta * Emitted (intersected, isect, pdf, from, fromN);
+            break;
         }
-            // if there is a diffuse component sample it
-            // do one bounce (do not recurse on indirect diffuse)
-        else if (!f->Kd.isZero() && isect.r_type != DIFF_REFL) {
-            RGB c_aux;
-            c_aux += diffuseReflection (isect, f, depth);
-        c_aux /= pdf[2];
-            color += c_aux;
+        // each vertex takes its random numbers from its own dimensions of the pixel sample
+        sampler->SetDimension(Sampler::VertexDimension(depth));
+        // get the BRDF
+        BRDF *f = isect.f;
+
+        if (!f->Kd.isZero()) {
+            // one light sample (selected as in directLighting's lightSampling mode)
+            Ray shadow;
+            float maxL;
+            RGB L;
+            color += beta * DirectLighting (isect, &shadow, &maxL, &L);
+            if (!L.isZero() && scene->visibility(shadow, maxL)) {
+                color += beta * L;
+            }
+            color += beta * IndirectDiffuse (isect);
         }
-        if (depth >= MIN_DEPTH)
-            color /= P_CONTINUE;
-    }
-    if (!f->Kd.isZero()) {
-        color += directLighting(scene, isect, f, rng, U_dist, UNIFORM_ONE);
-        // color += directLighting(scene, isect, f, rng, U_dist, ALL_LIGHTS);
+
+        Ray next;
+        RGB weight;
+        if (!Scatter (isect, depth, &next, &weight, &pdf)) break;
+        beta = beta * weight;
+        from = isect.p;
+        fromN = isect.sn;
+
+        // trace the next ray
+        intersected = scene->trace(next, &isect);
     }
     return color;
 };
@@ -11,24 +11,44 @@
 #include "shader.hpp"
 #include "BRDF.hpp"
 #include "directLighting.hpp"
-#include <random>
 
 class PathTracing: public Shader {
     RGB background;
-    RGB diffuseReflection (Intersection isect, BRDF *f, int depth);
-    RGB specularReflection (Intersection isect, BRDF *f, int depth);
-    RGB specularTransmission (Intersection isect, BRDF *f, int depth);
-    /****************************************
-     
-     Our Random Number Generator (rng) */
-    std::random_device rdev{};
-    std::mt19937 rng{rdev()};
-    std::uniform_real_distribution<float>U_dist{0.0,1.0};  // uniform distribution in[0,1[
-
+    // the ray that continues the path at isect for each kind of bounce
+    Ray diffuseReflection (Intersection const& isect, BRDF *f, RGB *weight, float *pdf);
+    Ray specularReflection (Intersection const& isect);
+    Ray specularTransmission (Intersection const& isect);
 
 public:
-    PathTracing (Scene *scene, RGB bg): background(bg), Shader(scene) {}
+    // multiple importance sampling: area lights hit by diffuse bounces add their emission,
+    // weighted against the light samples (power heuristic); else only the light samples count
+    bool mis;
+    // how lights are selected for the light samples (see directLighting); MIS needs a
+    // deferrable mode (UNIFORM_ONE, LIGHT_TREE), the others are shadow tested in place, unweighted
+    DIRECT_SAMPLE_MODE lightSampling;
+
+    PathTracing (Scene *scene, RGB bg, bool _mis=true, DIRECT_SAMPLE_MODE _lightSampling=UNIFORM_ONE):
+        background(bg), Shader(scene), mis(_mis), lightSampling(_lightSampling) {}
     RGB shade (bool intersected, Intersection isect, int depth);
+
+    // path vertex operations, shared by shade() and the stages of the WavefrontRenderer
+
+    // radiance arriving along the path that reached isect (background or emitter)
+    // pdf : that of the direction that reached isect, as returned by Scatter (0 for camera rays)
+    // from, fromN : the previous vertex's point and shading normal (for MIS; unused for camera rays)
+    RGB Emitted (bool intersected, Intersection const& isect, float pdf, Point const& from, Vector const& fromN);
+    // one light sample at isect with the shadow test left to the caller (see directLightingDeferred)
+    // (in the non deferrable lightSampling modes, the direct lighting with its shadow rays traced)
+    RGB DirectLighting (Intersection const& isect, Ray *shadow, float *maxL, RGB *Lcolor);
+    // indirect diffuse illumination at isect from the scene's photon map (Scene::BuildPhotonMap);
+    // with a photon map Scatter does not sample diffuse bounces, this estimate replaces them
+    RGB IndirectDiffuse (Intersection const& isect);
+    // Russian roulette and BRDF lobe selection: false if the path ends at isect,
+    // else the next ray, the weight to multiply the path throughput with and the
+    // solid angle pdf of its direction (BRDF::pdf; 0 for specular bounces)
+    bool Scatter (Intersection const& isect, int depth, Ray *next, RGB *weight, float *pdf);
+    // are light samples and BRDF sampled light hits combined with MIS ?
+    bool MIS () const { return mis && directLightingDeferrable(lightSampling) && !scene->photonMap; }
 };
 
 #endif /* PathTracing_hpp */
@@ -9,72 +9,84 @@
 #include "AmbientLight.hpp"
 #include "PointLight.hpp"
 #include "AreaLight.hpp"
+#include <algorithm>
+#include <vector>
+#include <cmath>
 
 static RGB direct_AmbientLight (AmbientLight * l, BRDF  *  f);
 static RGB direct_PointLight (PointLight  *  l, Scene *scene, Intersection isect, BRDF  *  f);
 static RGB direct_AreaLight (AreaLight * l, Scene *scene, Intersection isect, BRDF* f, float *r);
-static Light* powerWeightedLightSelection(Scene* scene, float rnd, float selected_pdf);
+static RGB direct_Light (Light *l, Scene *scene, Intersection isect, BRDF *f, Sampler *sampler);
+static RGB direct_Reservoir (Scene *scene, Intersection const& isect, BRDF *f, Sampler *sampler);
+static RGB direct_Visibility (Scene *scene, Intersection const& isect, BRDF *f, Sampler *sampler);
+static RGB direct_LightRoulette (Scene *scene, int const l_ndx, Intersection const& isect, BRDF *f, Sampler *sampler);
 
-RGB directLighting (Scene *scene, Intersection isect, BRDF *f, std::mt19937& rng, std::uniform_real_distribution<float>U_dist, DIRECT_SAMPLE_MODE mode) {
+RGB directLighting (Scene *scene, Intersection isect, BRDF *f, Sampler *sampler, DIRECT_SAMPLE_MODE mode) {
     RGB color (0.,0.,0.);
     
 #define XX 725
 #define YY 540
-    // Loop over scene's light sources
-    for (Light* l : scene->lights) {
-
-        /*if (mode==UNIFORM_ONE) {
-            int l_ndx = U_dist(rng)*scene->numLights;
-            if (isect.pix_x==XX && isect.pix_y==YY) {
-                fprintf (stderr, "numLights=%d, l_ndx=%d, ", scene->numLights, l_ndx);
-            }
-            if (l_ndx >= scene->numLights) l_ndx=scene->numLights-1;
-            if (isect.pix_x==XX && isect.pix_y==YY) {
-                fprintf (stderr, "l_ndx_corrected=%d \n", l_ndx);
-            }
-            l = scene->lights[l_ndx];
+    if (mode==LIGHT_TREE && scene->lightTree) {
+        // one light, selected with probability proportional to its estimated contribution
+        // at this point (light tree, O(log #lights)); ambient lights always contribute
+        LightTree const* tree = scene->lightTree;
+        for (Light* l : tree->AmbientLights()) {
+            color += direct_AmbientLight ((AmbientLight *)l, f);
+        }
+        float light_pdf;
+        int const l_ndx = tree->Sample(isect.p, isect.sn, sampler->Get1D(), &light_pdf);
+        if (l_ndx >= 0 && light_pdf > 0.0f) {
+            color += direct_Light(scene->lights[l_ndx], scene, isect, f, sampler) / light_pdf;
+        }
+    }
+    else if (mode==RESERVOIR) {
+        // ambient lights are not resampled: they always contribute
+        for (Light* l : scene->lights) {
+            if (l->type == AMBIENT_LIGHT) color += direct_AmbientLight ((AmbientLight *)l, f);
+        }
+        color += direct_Reservoir(scene, isect, f, sampler);
+    }
+    else if (mode==VISIBILITY && scene->visibilityCache) {
+        // ambient lights need no shadow rays: they always contribute
+        for (Light* l : scene->lights) {
+            if (l->type == AMBIENT_LIGHT) color += direct_AmbientLight ((AmbientLight *)l, f);
         }
-        */
-        if (mode==UNIFORM_ONE) {
-            float rnd = U_dist(rng);
+        color += direct_Visibility(scene, isect, f, sampler);
+    }
+    else if (mode==UNIFORM_ONE || mode==LIGHT_TREE) {
+        // one light, selected with probability proportional to its power (alias table, O(1));
+        // ambient lights are not sampled: they always contribute
+        LightDistribution const* dist = scene->lightDistribution;
+        if (dist) {
+            for (Light* l : dist->AmbientLights()) {
+                color += direct_AmbientLight ((AmbientLight *)l, f);
+            }
             float light_pdf;
-            Light* selected_light = powerWeightedLightSelection(scene, rnd, light_pdf);
-            if (selected_light && light_pdf > 0.0f) {
-                RGB contrib(0., 0., 0.);
-                
-                if (selected_light->type == AMBIENT_LIGHT) {
-                    contrib = direct_AmbientLight((AmbientLight*)selected_light, f);
-                } else if (selected_light->type == POINT_LIGHT) {
-                    contrib = direct_PointLight((PointLight*)selected_light, scene, isect, f);
-                } else if (selected_light->type == AREA_LIGHT) {
-                    float r[2] = {U_dist(rng), U_dist(rng)};
-                    contrib = direct_AreaLight((AreaLight*)selected_light, scene, isect, f, r);
-                }
-                
+            int const l_ndx = dist->Sample(sampler->Get1D(), &light_pdf);
+            if (l_ndx >= 0 && light_pdf > 0.0f) {
                 // Importância da amostra: contribuição dividida pelo PDF
-                color += contrib / light_pdf;
+                color += direct_Light(scene->lights[l_ndx], scene, isect, f, sampler) / light_pdf;
             }
-        } 
-        if (l->type == AMBIENT_LIGHT) {  // is it an ambient light ?
-            color += direct_AmbientLight ((AmbientLight *)l, f);
-            continue;
         }
-        if (l->type == POINT_LIGHT) {  // is it a point light ?
-            color += direct_PointLight ((PointLight *)l, scene, isect, f);
-            continue;
-        } // is POINT_LIGHT
-        if (l->type == AREA_LIGHT) {  // is it a area light ?
-            float r[2];
-            RGB color_temp(0.,0.,0.);
-            r[0] = U_dist(rng);
-            r[1] = U_dist(rng);
-            color_temp = direct_AreaLight ((AreaLight *)l, scene, isect, f, r);
-            color += color_temp;
-            if (isect.pix_x==XX && isect.pix_y==YY) {
-                fprintf (stderr, "ARea light contributes with (%f,%f,%f) \n", color.R, color.G, color.B);
-            }
-        } // is AREA_LIGHT
-    }  // loop over all light sources
+        else if (scene->numLights > 0) {
+            // no light distribution (Scene::BuildLightDistribution not called) : uniform selection
+            int l_ndx = sampler->Get1D()*scene->numLights;
+            if (l_ndx >= scene->numLights) l_ndx=scene->numLights-1;
+            color += direct_Light(scene->lights[l_ndx], scene, isect, f, sampler) * (float)scene->numLights;
+        }
+    }
+    else if (scene->visibilityCache) {
+        // all light sources, shadow rays by Russian roulette on their visibility
+        for (int l = 0 ; l < scene->numLights ; l++) {
+            color += direct_LightRoulette(scene, l, isect, f, sampler);
+        }
+    }
+    else {
+        // Loop over scene's light sources
+        for (Light* l : scene->lights) {
+            color += direct_Light(l, scene, isect, f, sampler);
+        }  // loop over all light sources
+    }
 
     if (isect.pix_x==XX && isect.pix_y==YY) {
         fprintf (stderr, "Direct contributes with (%f,%f,%f) \n", color.R, color.G, color.B);
@@ -83,163 +95,420 @@ RGB directLighting (Scene *scene, Intersection isect, BRDF *f, std::mt19937& rng
     return color;
 }
 
-
-
-// Nova implementação - Power Weighted Light Sampling
-static Light* powerWeightedLightSelection(Scene* scene, float rnd, float selected_pdf) {
-    if (scene->lights.empty()) return nullptr;
-
-    float total_power = 0.0f;
-    std::vector<float> light_powers(scene->lights.size());
-
-    for (size_t i = 0; i < scene->lights.size(); i++) {
-        Light* l = scene->lights[i];
-        float power = 0.0f;
-
-        if (l->type == AREA_LIGHT) {
-            AreaLight* al = (AreaLight*)l;
-            // Para área lights, potência = intensidade * área
-            power = (al->power.R + al->power.G + al->power.B) * al->gem->area();
-        } else if (l->type == POINT_LIGHT) {
-            PointLight* pl = (PointLight*)l;
-            // Para point lights, tratamos como tendo "área" 1 (ou poderia ser baseado na intensidade)
-            power = (pl->color.R + pl->color.G + pl->color.B);
-        } else if (l->type == AMBIENT_LIGHT) {
-            // Ambient lights não participam nesta seleção
-            continue;
+static RGB direct_Light (Light *l, Scene *scene, Intersection isect, BRDF *f, Sampler *sampler) {
+    if (l->type == AMBIENT_LIGHT) {  // is it an ambient light ?
+        return direct_AmbientLight ((AmbientLight *)l, f);
+    }
+    if (l->type == POINT_LIGHT) {  // is it a point light ?
+        return direct_PointLight ((PointLight *)l, scene, isect, f);
+    } // is POINT_LIGHT
+    if (l->type == AREA_LIGHT) {  // is it a area light ?
+        float r[2];
+        sampler->Get2D(r);
+        RGB const color = direct_AreaLight ((AreaLight *)l, scene, isect, f, r);
+        if (isect.pix_x==XX && isect.pix_y==YY) {
+            fprintf (stderr, "ARea light contributes with (%f,%f,%f) \n", color.R, color.G, color.B);
         }
+        return color;
+    } // is AREA_LIGHT
+    return RGB(0., 0., 0.);
+}
 
-        light_powers[i] = power;
-        total_power += power;
+static RGB direct_AmbientLight (AmbientLight * l, BRDF * f) {
+    RGB color (0., 0., 0.);
+    if (!f->Ka.isZero()) {
+        RGB Ka = f->Ka;
+        color += Ka * l->L();
     }
+    return (color);
+}
 
-    // Calcular PDFs e construir CDF
-    std::vector<float> pdfs(scene->lights.size(), 0.0f);
-    std::vector<float> cdf(scene->lights.size(), 0.0f);
-    float cdf_sum = 0.0f;
-
-    for (size_t i = 0; i < scene->lights.size(); i++) {
-        if (light_powers[i] > 0.0f) {
-            pdfs[i] = light_powers[i] / total_power;
-            cdf_sum += pdfs[i];
-            cdf[i] = cdf_sum;
-        }
+// diffuse reflectance at the intersection
+static RGB diffuse_Kd (Intersection const& isect, BRDF *f) {
+    if (f->textured) {
+        DiffuseTexture * df = (DiffuseTexture *)f;
+        return df->GetKd(isect.TexCoord);
     }
+    return f->Kd;
+}
 
-    // Normalizar CDF (devido a possíveis luzes não consideradas como ambient)
-    if (cdf_sum > 0.0f) {
-        for (size_t i = 0; i < scene->lights.size(); i++) {
-            cdf[i] /= cdf_sum;
+// unshadowed contribution of point Lpos on light l, with emitted radiance L, in area measure
+// (i.e., not yet divided by the pdf of Lpos); also returns the direction and distance to Lpos
+// zero if Lpos is below the surface or, for area lights, behind the emitter
+static RGB light_Integrand (Light *l, Point const& Lpos, RGB L, Intersection const& isect, RGB Kd,
+                            Vector *Ldir, float *Ldistance) {
+    *Ldir = isect.p.vec2point(Lpos);
+    *Ldistance = Ldir->norm();
+    Ldir->normalize();
+    float const cosL = Ldir->dot(isect.sn);
+    RGB color (0., 0., 0.);
+
+    if (l->type == POINT_LIGHT) {
+        if (cosL>0) {
+            color = L * Kd * cosL;
+            if (*Ldistance>0.f) color /= (*Ldistance * *Ldistance);
         }
     }
-
-    // Selecionar luz baseada no CDF
-    for (size_t i = 0; i < scene->lights.size(); i++) {
-        if (rnd <= cdf[i] && light_powers[i] > 0.0f) {
-            selected_pdf = pdfs[i];
-            return scene->lights[i];
+    else if (l->type == AREA_LIGHT) {
+        float const cosLN_l = -1.f * Ldir->dot(((AreaLight *)l)->gem->normal);
+        if (cosL>1.e-4 && cosLN_l>1.e-4) {
+            color = L * Kd * cosL;
+            if (*Ldistance>0.f) color /= (*Ldistance * *Ldistance);
+            color *= cosLN_l;
         }
     }
-
-    // Fallback (não deveria acontecer)
-    selected_pdf = 1.0f / scene->lights.size();
-    return scene->lights[0];
+    return color;
 }
 
+// shadow ray from the intersection towards direction Ldir
+static Ray shadow_Ray (Intersection const& isect, Vector const& Ldir) {
+    Ray shadow = Ray(isect.p, Ldir, SHADOW);
+    shadow.pix_x = isect.pix_x;
+    shadow.pix_y = isect.pix_y;
 
+    shadow.adjustOrigin(isect.gn);
+    return shadow;
+}
 
+static bool light_Visible (Scene *scene, Intersection const& isect, Vector const& Ldir, float const Ldistance) {
+    return scene->visibility(shadow_Ray(isect, Ldir), Ldistance-EPSILON);
+}
 
+// probability of sample_Light selecting light l_ndx; with p != NULL and a light tree, that
+// of the tree selecting it for the point *p with normal *n (see sample_Light)
+static float light_SelectionPdf (Scene *scene, int const l_ndx, Point const* p = NULL, Vector const* n = NULL) {
+    if (p != NULL && scene->lightTree) return scene->lightTree->Pdf(*p, *n, l_ndx);
+    LightDistribution const* dist = scene->lightDistribution;
+    if (dist) return dist->Pdf(l_ndx);
+    return (scene->numLights > 0) ? 1.f / scene->numLights : 0.f;
+}
 
+// BRDF::pdf of scattering towards Ldir at the intersection (BRDFs work in the shading frame)
+static float brdf_Pdf (Intersection const& isect, BRDF *f, Vector const& Ldir) {
+    Vector Rx, Ry;
+    isect.gn.CoordinateSystem(&Rx, &Ry);
+    return f->pdf(isect.wo.ToLocal(Rx, Ry, isect.sn), Ldir.ToLocal(Rx, Ry, isect.sn));
+}
 
-static RGB direct_AmbientLight (AmbientLight * l, BRDF * f) {
-    RGB color (0., 0., 0.);
-    if (!f->Ka.isZero()) {
-        RGB Ka = f->Ka;
-        color += Ka * l->L();
+// a point Lpos on a point or area light, its radiance L and its pdf (area measure; 1 for point lights)
+// false for other lights (ambient lights are not sampled)
+static bool sample_Point (Light *l, Sampler *sampler, Point *Lpos, RGB *L, float *pdf) {
+    *pdf = 1.f;
+    if (l->type == AREA_LIGHT) {
+        float rnd[2];
+        sampler->Get2D(rnd);
+        *L = ((AreaLight *)l)->Sample_L(rnd, Lpos, *pdf);
+        return true;
     }
-    return (color);
+    if (l->type == POINT_LIGHT) {
+        *L = l->Sample_L(NULL, Lpos);
+        return true;
+    }
+    return false;
 }
 
-static RGB direct_PointLight (PointLight* l, Scene *scene, Intersection isect, BRDF * f) {
-    RGB color (0., 0., 0.);
-    RGB Kd;
-    
-    if (f->textured) {
-        DiffuseTexture * df = (DiffuseTexture *)f;
-        Kd = df->GetKd(isect.TexCoord);
+// select a point or area light by power (or uniformly, if there is no light distribution)
+// and a point Lpos on it; returns its index in scene->lights (-1 if none), its radiance L
+// and the pdf of the pair (selection pdf times area pdf)
+// with at != NULL and a light tree, the light is selected by its estimated contribution at 'at'
+static int sample_Light (Scene *scene, Sampler *sampler,
+                         Point *Lpos, RGB *L, float *pdf, Intersection const* at = NULL) {
+    LightDistribution const* dist = scene->lightDistribution;
+    int l_ndx;
+    float light_pdf;
+    if (at != NULL && scene->lightTree) {
+        l_ndx = scene->lightTree->Sample(at->p, at->sn, sampler->Get1D(), &light_pdf);
+    }
+    else if (dist) {
+        l_ndx = dist->Sample(sampler->Get1D(), &light_pdf);
     }
     else {
-        Kd = f->Kd;
+        l_ndx = sampler->Get1D()*scene->numLights;
+        if (l_ndx >= scene->numLights) l_ndx=scene->numLights-1;
+        light_pdf = 1.f / scene->numLights;
     }
+    if (l_ndx < 0 || light_pdf <= 0.f) return -1;
+
+    float area_pdf;
+    if (!sample_Point(scene->lights[l_ndx], sampler, Lpos, L, &area_pdf)) return -1;
+    *pdf = light_pdf * area_pdf;
+    return l_ndx;
+}
+
+static RGB direct_PointLight (PointLight* l, Scene *scene, Intersection isect, BRDF * f) {
+    RGB color (0., 0., 0.);
+    RGB Kd = diffuse_Kd(isect, f);
 
     if (!Kd.isZero()) {
         Point Lpos;
+        Vector Ldir;
+        float Ldistance;
         RGB L = l->Sample_L(NULL, &Lpos);
-        Vector Ldir=isect.p.vec2point(Lpos);
-        float Ldistance = Ldir.norm();
-        Ldir.normalize();
-        float cosL = Ldir.dot(isect.sn);
-        if (cosL>0) {
-            
-            Ray shadow = Ray(isect.p, Ldir, SHADOW);
-            shadow.pix_x = isect.pix_x;
-            shadow.pix_y = isect.pix_y;
-            
-            shadow.adjustOrigin(isect.gn);
-            
-            if (scene->visibility(shadow, Ldistance-EPSILON)) {
-                color += L * Kd * cosL;
-                if (Ldistance>0.f) color /= (Ldistance*Ldistance);
-            }
+        color = light_Integrand(l, Lpos, L, isect, Kd, &Ldir, &Ldistance);
+        if (!color.isZero() && !light_Visible(scene, isect, Ldir, Ldistance)) {
+            color = RGB(0., 0., 0.);
         }
     } // Kd is zero
 
-    
     return (color);
 }
 
 static RGB direct_AreaLight (AreaLight* l, Scene *scene, Intersection isect, BRDF* f, float *r) {
     RGB color (0., 0., 0.);
-    RGB Kd;
-    float pdf, cosL, cosLN_l, Ldistance;
-    RGB L;
-    Point Lpos;
-    
-    if (f->textured) {
-        DiffuseTexture * df = (DiffuseTexture *)f;
-        Kd = df->GetKd(isect.TexCoord);
-    }
-    else {
-        Kd = f->Kd;
-    }
+    RGB Kd = diffuse_Kd(isect, f);
 
-    pdf = 0.;
     if (!Kd.isZero()) {
         Point Lpos;
-        
-        L = l->Sample_L(r, &Lpos, pdf);
+        Vector Ldir;
+        float Ldistance, pdf = 0.;
+        RGB L = l->Sample_L(r, &Lpos, pdf);
         // the pdf computed above is just 1/Area
-        Vector Ldir=isect.p.vec2point(Lpos);
-        Ldistance = Ldir.norm();
-        Ldir.normalize();
-        cosL = Ldir.dot(isect.sn);
-        cosLN_l = -1.f * Ldir.dot(l->gem->normal);
-        if (cosL>1.e-4 && cosLN_l>1.e-4) {
-            
-            Ray shadow = Ray(isect.p, Ldir, SHADOW);
-            shadow.pix_x = isect.pix_x;
-            shadow.pix_y = isect.pix_y;
-            
-            shadow.adjustOrigin(isect.gn);
-            
-            if (scene->visibility(shadow, Ldistance-EPSILON)) {
-                color = L * Kd * cosL;
-                if (pdf >0.) color /= pdf;
-                if (Ldistance>0.f) color /= (Ldistance*Ldistance);
-                color *= cosLN_l;
-            }
+        color = light_Integrand(l, Lpos, L, isect, Kd, &Ldir, &Ldistance);
+        if (!color.isZero() && light_Visible(scene, isect, Ldir, Ldistance)) {
+            if (pdf >0.) color /= pdf;
         }
+        else color = RGB(0., 0., 0.);
     } // Kd is zero
-    
+
     return (color);
 }
+
+// emitted radiance at a previously sampled point Lpos of light l
+static RGB light_Radiance (Light *l, Point const& Lpos) {
+    if (l->type == AREA_LIGHT) return ((AreaLight *)l)->intensity;
+    return l->L(Lpos);
+}
+
+// target density of a reservoir sample: luminance of its unshadowed contribution
+static float target_Pdf (Scene *scene, int const l_ndx, Point const& Lpos, Intersection const& isect, RGB const& Kd) {
+    Light *l = scene->lights[l_ndx];
+    Vector Ldir;
+    float Ldistance;
+    return light_Integrand(l, Lpos, light_Radiance(l, Lpos), isect, Kd, &Ldir, &Ldistance).Y();
+}
+
+// can a reservoir built at (q.p, q.n) be reused at this intersection?
+static bool reuse_Similar (Reservoir const& q, Intersection const& isect) {
+    if (q.light < 0 || q.M <= 0.f) return false;
+    if (q.n.dot(isect.sn) < 0.9f) return false;
+    return fabsf(isect.sn.dot(isect.p.vec2point(q.p))) < 0.1f * isect.depth;
+}
+
+// resampled importance sampling: RIS_CANDIDATES light samples drawn from the light
+// power distribution (or uniformly) are streamed through a reservoir, which keeps one
+// with probability proportional to its unshadowed contribution; only that one is shadow tested
+// for primary hits, if the scene has a reservoir buffer, the reservoir is combined with the
+// pixel's previous one (temporal) and with neighbouring pixels' reservoirs of the previous
+// frame (spatial); the visibility of reused samples is not re-tested, which is biased
+static RGB direct_Reservoir (Scene *scene, Intersection const& isect, BRDF *f, Sampler *sampler) {
+    RGB Kd = diffuse_Kd(isect, f);
+    if (Kd.isZero() || scene->numLights <= 0) return RGB(0., 0., 0.);
+
+    Reservoir r;
+    r.p = isect.p;
+    r.n = isect.sn;
+    float phat = 0.f;
+
+    for (int c = 0 ; c < RIS_CANDIDATES ; c++) {
+        Point Lpos;
+        RGB L;
+        float pdf;
+        int const l_ndx = sample_Light(scene, sampler, &Lpos, &L, &pdf);
+        if (l_ndx < 0) {
+            r.M += 1.f;
+            continue;
+        }
+        Vector Ldir;
+        float Ldistance;
+        float const p = light_Integrand(scene->lights[l_ndx], Lpos, L, isect, Kd, &Ldir, &Ldistance).Y();
+        if (r.Update(l_ndx, Lpos, p / pdf, sampler->Get1D())) phat = p;
+    }
+
+    ReservoirBuffer *buffer = (isect.r_type == PRIMARY) ? scene->reservoirs : nullptr;
+    Reservoir *stored = buffer ? buffer->Current(isect.pix_x, isect.pix_y) : nullptr;
+    float const maxM = stored ? buffer->maxHistory * r.M : 0.f;
+    if (stored) {
+        r.W = (phat > 0.f) ? r.wSum / (r.M * phat) : 0.f;
+
+        if (buffer->temporal) {
+            // this pixel's previous sample, or the previous frame for its first one
+            Reservoir q = (stored->M > 0.f) ? *stored : *buffer->Previous(isect.pix_x, isect.pix_y);
+            if (reuse_Similar(q, isect)) {
+                q.M = std::min(q.M, maxM);
+                float const p = target_Pdf(scene, q.light, q.Lpos, isect, Kd);
+                if (r.Merge(q, p, sampler->Get1D())) phat = p;
+            }
+        }
+        if (buffer->spatial) {
+            int const R = buffer->spatialRadius;
+            for (int k = 0 ; k < buffer->spatialSamples ; k++) {
+                int const x = isect.pix_x + (int)((2.f * sampler->Get1D() - 1.f) * R);
+                int const y = isect.pix_y + (int)((2.f * sampler->Get1D() - 1.f) * R);
+                Reservoir const *q = buffer->Previous(x, y);
+                if (!q || !reuse_Similar(*q, isect)) continue;
+                Reservoir qc = *q;
+                qc.M = std::min(qc.M, maxM);
+                float const p = target_Pdf(scene, qc.light, qc.Lpos, isect, Kd);
+                if (r.Merge(qc, p, sampler->Get1D())) phat = p;
+            }
+        }
+    }
+
+    RGB color (0., 0., 0.);
+    r.W = (phat > 0.f && r.light >= 0) ? r.wSum / (r.M * phat) : 0.f;
+    if (r.W > 0.f) {
+        Light *l = scene->lights[r.light];
+        Vector Ldir;
+        float Ldistance;
+        color = light_Integrand(l, r.Lpos, light_Radiance(l, r.Lpos), isect, Kd, &Ldir, &Ldistance);
+        if (light_Visible(scene, isect, Ldir, Ldistance)) {
+            color *= r.W;
+        }
+        else {
+            // occluded samples are not propagated to other pixels / samples
+            color = RGB(0., 0., 0.);
+            r.W = 0.f;
+        }
+    }
+    if (stored) {
+        r.M = std::min(r.M, maxM);
+        *stored = r;
+    }
+    return color;
+}
+
+// one light selected with probability proportional to its selection pdf (power, see sample_Light)
+// times its visibility from the point's cell, as estimated by the visibility cache; the outcome
+// of the shadow ray is recorded in the cache
+static RGB direct_Visibility (Scene *scene, Intersection const& isect, BRDF *f, Sampler *sampler) {
+    RGB Kd = diffuse_Kd(isect, f);
+    if (Kd.isZero() || scene->numLights <= 0) return RGB(0., 0., 0.);
+
+    VisibilityCache *cache = scene->visibilityCache;
+    int const n = scene->numLights;
+    static thread_local std::vector<float> w;
+    w.resize(n);
+    cache->Visibilities(isect.p, w.data());
+    float sum = 0.f;
+    for (int l = 0 ; l < n ; l++) {
+        bool const sampled = scene->lights[l]->type == AREA_LIGHT || scene->lights[l]->type == POINT_LIGHT;
+        w[l] = sampled ? light_SelectionPdf(scene, l) * std::max(w[l], MIN_VISIBILITY) : 0.f;
+        sum += w[l];
+    }
+    if (sum <= 0.f) return RGB(0., 0., 0.);
+
+    // linear search on the weights: O(#lights), as building them already is
+    float u = sampler->Get1D() * sum;
+    int l_ndx = -1;
+    for (int l = 0 ; l < n ; l++) {
+        if (w[l] <= 0.f) continue;
+        l_ndx = l;
+        if (u < w[l]) break;
+        u -= w[l];
+    }
+    float const light_pdf = w[l_ndx] / sum;
+
+    Point Lpos;
+    RGB L;
+    float area_pdf;
+    Light *l = scene->lights[l_ndx];
+    sample_Point(l, sampler, &Lpos, &L, &area_pdf);
+
+    Vector Ldir;
+    float Ldistance;
+    RGB color = light_Integrand(l, Lpos, L, isect, Kd, &Ldir, &Ldistance);
+    // below the horizon / behind the emitter : not a visibility test
+    if (color.isZero()) return color;
+
+    bool const visible = light_Visible(scene, isect, Ldir, Ldistance);
+    cache->Record(isect.p, l_ndx, visible);
+    if (!visible) return RGB(0., 0., 0.);
+    return color / (light_pdf * area_pdf);
+}
+
+// one sample of light l_ndx whose shadow ray is traced only with probability equal to the light's
+// estimated visibility from the point's cell (Russian roulette); the outcome is recorded in the cache
+static RGB direct_LightRoulette (Scene *scene, int const l_ndx, Intersection const& isect, BRDF *f, Sampler *sampler) {
+    Light *l = scene->lights[l_ndx];
+    if (l->type == AMBIENT_LIGHT) return direct_AmbientLight ((AmbientLight *)l, f);
+
+    RGB Kd = diffuse_Kd(isect, f);
+    Point Lpos;
+    RGB L;
+    float area_pdf;
+    if (Kd.isZero() || !sample_Point(l, sampler, &Lpos, &L, &area_pdf)) return RGB(0., 0., 0.);
+
+    Vector Ldir;
+    float Ldistance;
+    RGB color = light_Integrand(l, Lpos, L, isect, Kd, &Ldir, &Ldistance);
+    if (color.isZero()) return color;
+
+    VisibilityCache *cache = scene->visibilityCache;
+    float const q = std::max(cache->Visibility(isect.p, l_ndx), MIN_VISIBILITY);
+    if (sampler->Get1D() >= q) return RGB(0., 0., 0.);
+
+    bool const visible = light_Visible(scene, isect, Ldir, Ldistance);
+    cache->Record(isect.p, l_ndx, visible);
+    if (!visible) return RGB(0., 0., 0.);
+    return color / (area_pdf * q);
+}
+
+RGB directLightingDeferred (Scene *scene, Intersection const& isect, BRDF *f, Sampler *sampler,
+                            Ray *shadow, float *maxL, RGB *Lcolor, DIRECT_SAMPLE_MODE mode, bool mis) {
+    RGB color (0., 0., 0.);
+    *Lcolor = RGB(0., 0., 0.);
+
+    // the other modes trace their shadow rays as they go (several, or recorded in the visibility cache)
+    if (!directLightingDeferrable(mode)) {
+        return directLighting(scene, isect, f, sampler, mode);
+    }
+    // LIGHT_TREE : selection at this point (by power if there is no tree, as directLighting)
+    Intersection const* at = (mode == LIGHT_TREE) ? &isect : NULL;
+
+    // ambient lights need no shadow ray
+    for (Light* l : scene->lights) {
+        if (l->type == AMBIENT_LIGHT) color += direct_AmbientLight ((AmbientLight *)l, f);
+    }
+
+    RGB Kd = diffuse_Kd(isect, f);
+    if (Kd.isZero() || scene->numLights <= 0) return color;
+
+    Point Lpos;
+    RGB L;
+    float pdf;
+    int const l_ndx = sample_Light(scene, sampler, &Lpos, &L, &pdf, at);
+    if (l_ndx < 0) return color;
+
+    Light *l = scene->lights[l_ndx];
+    Vector Ldir;
+    float Ldistance;
+    RGB c = light_Integrand(l, Lpos, L, isect, Kd, &Ldir, &Ldistance);
+    if (!c.isZero()) {
+        *shadow = shadow_Ray(isect, Ldir);
+        *maxL = Ldistance-EPSILON;
+        *Lcolor = c / pdf;
+        // point lights cannot be hit by BRDF sampled rays: their samples keep all the weight
+        if (mis && l->type == AREA_LIGHT) {
+            float const light_pdf = light_SelectionPdf(scene, l_ndx, at ? &isect.p : NULL, &isect.sn) *
+                                    ((AreaLight *)l)->pdf_SolidAngle(Ldir, Ldistance);
+            *Lcolor *= PowerHeuristic(light_pdf, brdf_Pdf(isect, f, Ldir));
+        }
+    }
+    return color;
+}
+
+RGB directLightingMIS (Scene *scene, Intersection const& isect, float const brdf_pdf,
+                       DIRECT_SAMPLE_MODE mode, Point const& from, Vector const& fromN) {
+    if (!isect.isLight || isect.light_ndx < 0 || isect.light_ndx >= scene->numLights) return RGB(0., 0., 0.);
+    Light *l = scene->lights[isect.light_ndx];
+    if (l->type != AREA_LIGHT) return RGB(0., 0., 0.);
+    AreaLight *al = (AreaLight *)l;
+
+    // the ray came along -wo; seen from behind, the light emits nothing (as in light_Integrand)
+    Vector const wi = -1.f * isect.wo;
+    float const light_pdf = light_SelectionPdf(scene, isect.light_ndx, (mode == LIGHT_TREE) ? &from : NULL, &fromN) *
+                            al->pdf_SolidAngle(wi, isect.depth);
+    if (light_pdf <= 0.f) return RGB(0., 0., 0.);
+    // the radiance the light samples integrate (light_Radiance)
+    return al->intensity * PowerHeuristic(brdf_pdf, light_pdf);
+}
@@ -11,15 +11,59 @@
 #include "RGB.hpp"
 #include "intersection.hpp"
 #include "scene.hpp"
-#include <random>
+#include "sampler.hpp"
 #include "shader.hpp"
 #include "DiffuseTexture.hpp"
 
 typedef  enum {
         ALL_LIGHTS,
-        UNIFORM_ONE
+        UNIFORM_ONE,    // one light, selected by power (Scene::BuildLightDistribution)
+        LIGHT_TREE,     // one light, selected by its estimated contribution at the point (Scene::BuildLightTree)
+        RESERVOIR,      // RIS_CANDIDATES light samples resampled to one, reused among pixels (Scene::BuildReservoirBuffer)
+        VISIBILITY      // one light, selected by power times its visibility from the point's cell (Scene::BuildVisibilityCache)
 }    DIRECT_SAMPLE_MODE;
+// with a visibility cache, ALL_LIGHTS traces the shadow ray to each light with a probability
+// equal to its estimated visibility (Russian roulette), so few rays go to occluded lights
 
-RGB directLighting (Scene *scene, Intersection isect, BRDF *f, std::mt19937& rng, std::uniform_real_distribution<float>U_dist, DIRECT_SAMPLE_MODE mode=ALL_LIGHTS);
+// number of candidate light samples per shading point in RESERVOIR mode
+#define RIS_CANDIDATES 16
+
+// lowest visibility used by the visibility cache modes, so that lights seen as occluded
+// still get (a few) samples and the estimate stays unbiased
+#define MIN_VISIBILITY 0.05f
+
+RGB directLighting (Scene *scene, Intersection isect, BRDF *f, Sampler *sampler, DIRECT_SAMPLE_MODE mode=ALL_LIGHTS);
+
+// the modes whose single light sample can have its shadow test left to the caller
+// (and be weighted for MIS: their selection pdf can be evaluated for any light)
+inline bool directLightingDeferrable (DIRECT_SAMPLE_MODE const mode) {
+    return mode == UNIFORM_ONE || mode == LIGHT_TREE;
+}
+
+// one light sample selected as in directLighting (UNIFORM_ONE or LIGHT_TREE) whose shadow test
+// is left to the caller
+// returns the contribution that needs no shadow ray (ambient lights); if *Lcolor is not zero,
+// it must be added only if scene->visibility(*shadow, *maxL)
+// mis: the caller also samples f (BRDF::pdf) and adds the area lights its rays hit, weighted by
+// directLightingMIS; the area light sample is weighted with the power heuristic
+// for the other modes this is directLighting, shadow rays included (*Lcolor is zero, no MIS)
+RGB directLightingDeferred (Scene *scene, Intersection const& isect, BRDF *f, Sampler *sampler,
+                            Ray *shadow, float *maxL, RGB *Lcolor, DIRECT_SAMPLE_MODE mode=UNIFORM_ONE, bool mis=false);
+
+// the radiance of the area light hit at isect by a ray sampled from the BRDF at the point 'from'
+// (shading normal fromN) with (solid angle) pdf brdf_pdf, weighted by the power heuristic against
+// the light sample that directLightingDeferred took there in the same (deferrable) mode
+RGB directLightingMIS (Scene *scene, Intersection const& isect, float const brdf_pdf,
+                       DIRECT_SAMPLE_MODE mode, Point const& from, Vector const& fromN);
+
+// multiple importance sampling heuristics (Veach 1997) : weight of a sample drawn with pdf fPdf
+// that the other technique would have drawn with pdf gPdf (one sample per technique)
+inline float BalanceHeuristic (float const fPdf, float const gPdf) {
+    return (fPdf > 0.f) ? fPdf / (fPdf + gPdf) : 0.f;
+}
+inline float PowerHeuristic (float const fPdf, float const gPdf) {
+    float const f2 = fPdf * fPdf, g2 = gPdf * gPdf;
+    return (f2 > 0.f) ? f2 / (f2 + g2) : 0.f;
+}
 
 #endif /* directLighting_hpp */
@@ -0,0 +1,8 @@
+//
+//  shader.cpp
+//  VI-RT
+//
+
+#include "shader.hpp"
+
+thread_local Sampler *Shader::sampler = nullptr;
@@ -10,13 +10,20 @@
 
 #include "scene.hpp"
 #include "RGB.hpp"
+#include "sampler.hpp"
 
 class Shader {
+protected:
+    // the calling thread's sampler, positioned by the renderer at the pixel sample being shaded
+    // one per thread, so that several render threads can share a shader
+    static thread_local Sampler *sampler;
 public:
     Scene *scene;
     Shader (Scene *_scene): scene(_scene) {}
     ~Shader () {}
     virtual RGB shade (bool intersected, Intersection isect, int depth) {return RGB();}
+    // set the calling thread's sampler (the renderers own one sampler per thread)
+    static void SetSampler (Sampler *s) { sampler = s; }
 };
 
 #endif /* shader_hpp */
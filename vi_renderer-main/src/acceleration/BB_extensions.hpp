@@ -29,6 +29,17 @@ inline Point Centroid(const BB& bb) {
                 (bb.min.Z + bb.max.Z) * 0.5f);
 }
 
+// coordenada dim (0=X, 1=Y, 2=Z) de um ponto
+inline float Coord(const Point& p, int dim) {
+    return (dim == 0) ? p.X : (dim == 1) ? p.Y : p.Z;
+}
+
+// posição do ponto p relativamente à caixa, em [0,1] por eixo (pbrt Bounds3::Offset)
+inline float Offset(const BB& bb, const Point& p, int dim) {
+    float const lo = Coord(bb.min, dim), hi = Coord(bb.max, dim);
+    return (hi > lo) ? (Coord(p, dim) - lo) / (hi - lo) : 0.f;
+}
+
 inline BB Union(const BB& b1, const BB& b2) {
     BB result;
     result.min = Point(std::min(b1.min.X, b2.min.X),
@@ -51,6 +62,7 @@ inline BB Union(const BB& b, const Point& p) {
     return result;
 }
 
+// a caixa só conta se intersetar o intervalo [ray.tMin, ray.tMax] do raio
 inline bool IntersectP(const BB& bb, const Ray& ray, const Vector& invDir, 
                       const int dirIsNeg[3]) {
     const Point bounds[2] = {bb.min, bb.max};
@@ -77,7 +89,7 @@ inline bool IntersectP(const BB& bb, const Ray& ray, const Vector& invDir,
     tMin = std::max(tMin, tzMin);
     tMax = std::min(tMax, tzMax);
     
-    return (tMin < 1e30f) && (tMax > 1e-6f); 
+    return (tMin < ray.tMax) && (tMax > ray.tMin); 
 }
 
 #endif
\ No newline at end of file
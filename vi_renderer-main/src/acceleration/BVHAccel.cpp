@@ -1,11 +1,22 @@
 #include "BVHAccel.hpp"
+#include "WideBVH.hpp"
 #include <algorithm>
 #include <iostream>
 #include <climits>
+#include <limits>
+#include <thread>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
 
 // Construtor - segue estrutura do PBR book, mas com alterações para ser compatível com o código já existente
-BVHAccel::BVHAccel(std::vector<Primitive*>& p, BRDF** mats, int maxPrimsInNode, SplitMethod splitMethod)
-    : materials(mats), maxPrimsInNode(std::min(255, maxPrimsInNode)), primitives(p), splitMethod(splitMethod) {
+BVHAccel::BVHAccel(std::vector<Primitive*>& p, BRDF** mats, int maxPrimsInNode, SplitMethod splitMethod,
+                   BVHLayout layout)
+    : materials(mats), maxPrimsInNode(std::min(255, maxPrimsInNode)), primitives(p), splitMethod(splitMethod),
+      nodes(nullptr), totalNodes(0), leaves(nullptr), wide4(nullptr), wide8(nullptr) {
     
     if (primitives.size() == 0) return;
     
@@ -20,12 +31,15 @@ BVHAccel::BVHAccel(std::vector<Primitive*>& p, BRDF** mats, int maxPrimsInNode,
     }
     
     // Build BVH tree
-    int totalNodes = 0;
-    std::vector<Primitive*> orderedPrims;
-    orderedPrims.reserve(primitives.size());
-    
-    BVHBuildNode* root = recursiveBuild(primitiveInfo, 0, primitives.size(), 
-                                   &totalNodes, orderedPrims);
+    // As folhas escrevem diretamente em orderedPrims[start..end[, por isso as
+    // subárvores podem ser construídas em paralelo sem sincronização
+    std::vector<Primitive*> orderedPrims(primitives.size());
+    BVHBuildState state;
+    BuildArena* rootArena = state.NewArena();
+    
+    BVHBuildNode* root = recursiveBuild(state, *rootArena, primitiveInfo, 0, primitives.size(),
+                                        orderedPrims);
+    totalNodes = state.totalNodes;
 
     fprintf(stdout, "Root bounding box: min(%.1f,%.1f,%.1f) max(%.1f,%.1f,%.1f)\n",
         root->bounds.min.X, root->bounds.min.Y, root->bounds.min.Z,
@@ -34,25 +48,105 @@ BVHAccel::BVHAccel(std::vector<Primitive*>& p, BRDF** mats, int maxPrimsInNode,
     primitives.swap(orderedPrims);
     
     // Convert to linear representation  
-    nodes = new LinearBVHNode[totalNodes];
+    void* mem = nullptr;
+    if (posix_memalign(&mem, BVH_NODE_ALIGNMENT, sizeof(LinearBVHNode) * totalNodes) != 0) {
+        throw std::bad_alloc();
+    }
+    nodes = static_cast<LinearBVHNode*>(mem);
     int offset = 0;
     flattenBVHTree(root, &offset);
     
+    // Os build nodes já não são necessários: libertar as arenas
+    state.arenas.clear();
+    
     fprintf(stdout, "BVH built: %d nodes for %zu primitives\n", totalNodes, primitives.size());
+    
+    // Triângulos de cada folha em blocos SoA de 4 (Moller-Trumbore SIMD)
+    std::vector<std::pair<int, int>> leafRanges;
+    for (int i = 0; i < totalNodes; ++i) {
+        if (nodes[i].nPrimitives > 0) leafRanges.push_back(std::make_pair(nodes[i].primitivesOffset, (int)nodes[i].nPrimitives));
+    }
+    leaves = new LeafPrimitives(primitives, materials);
+    leaves->Build(primitives, leafRanges);
+    fprintf(stdout, "Triangle blocks: %d (%zu bytes each)\n", leaves->BlockCount(), sizeof(TriangleBlock4));
+    
+    // Colapsar em BVH largo; o binário é mantido para as estatísticas
+    if (layout == BVHLayout::Wide4) {
+        wide4 = new WideBVH<4>(nodes, *leaves);
+        fprintf(stdout, "Wide BVH (4) built: %d nodes\n", wide4->NodeCount());
+    } else if (layout == BVHLayout::Wide8) {
+        wide8 = new WideBVH<8>(nodes, *leaves);
+        fprintf(stdout, "Wide BVH (8) built: %d nodes\n", wide8->NodeCount());
+    }
+}
+
+// Estatísticas da árvore, incluindo o custo SAH total:
+// soma sobre os nós de (SA(nó)/SA(raiz)) * custo do nó, com custo = C_trav (interior) ou n * C_isect (folha)
+void BVHAccel::printStats() const {
+    if (!nodes || totalNodes == 0) {
+        fprintf(stdout, "BVH is empty\n");
+        return;
+    }
+    
+    const float invRootArea = 1.f / SurfaceArea(nodes[0].Bounds());
+    int interiorNodes = 0, leafNodes = 0, maxLeafPrims = 0, maxDepth = 0;
+    float sahCost = 0.f;
+    
+    // percorrer a árvore para obter a profundidade
+    int stack[64], depthStack[64], top = 0;
+    stack[top] = 0; depthStack[top++] = 0;
+    while (top > 0) {
+        --top;
+        const LinearBVHNode* node = &nodes[stack[top]];
+        const int nodeIndex = stack[top], depth = depthStack[top];
+        const float relArea = SurfaceArea(node->Bounds()) * invRootArea;
+        maxDepth = std::max(maxDepth, depth);
+        
+        if (node->nPrimitives > 0) {
+            leafNodes++;
+            maxLeafPrims = std::max(maxLeafPrims, (int)node->nPrimitives);
+            sahCost += relArea * SAH_INTERSECT_COST * node->nPrimitives;
+        } else {
+            interiorNodes++;
+            sahCost += relArea * SAH_TRAVERSAL_COST;
+            stack[top] = nodeIndex + 1;             depthStack[top++] = depth + 1;
+            stack[top] = node->secondChildOffset;   depthStack[top++] = depth + 1;
+        }
+    }
+    
+    fprintf(stdout, "BVH stats: %d nodes (%d interior, %d leaves), max depth %d\n",
+            totalNodes, interiorNodes, leafNodes, maxDepth);
+    fprintf(stdout, "           %.2f prims/leaf (max %d, maxPrimsInNode %d)\n",
+            (float)primitives.size() / leafNodes, maxLeafPrims, maxPrimsInNode);
+    fprintf(stdout, "           SAH cost = %.3f (C_trav=%.3f, C_isect=%.3f)\n",
+            sahCost, SAH_TRAVERSAL_COST, SAH_INTERSECT_COST);
+    
+    const size_t nodeBytes = sizeof(LinearBVHNode) * (size_t)totalNodes;
+    const size_t primBytes = sizeof(Primitive*) * primitives.size();
+    fprintf(stdout, "           memory: %zu bytes/node (aligned to %zu), nodes %.2f MB + prim refs %.2f MB = %.2f MB\n",
+            sizeof(LinearBVHNode), BVH_NODE_ALIGNMENT,
+            nodeBytes / (1024. * 1024.), primBytes / (1024. * 1024.),
+            (nodeBytes + primBytes) / (1024. * 1024.));
+    if (wide4) wide4->printStats();
+    if (wide8) wide8->printStats();
 }
 
 BVHAccel::~BVHAccel() {
-    delete[] nodes;
+    delete wide4;
+    delete wide8;
+    delete leaves;
+    free(nodes);
 }
 
-// Construção recursiva com SAH
+// Construção recursiva; com SplitMethod::SAH usa SAH com buckets (binned)
 BVHBuildNode* BVHAccel::recursiveBuild(
+    BVHBuildState& state, BuildArena& arena,
     std::vector<BVHPrimitiveInfo>& primitiveInfo,
-    int start, int end, int* totalNodes,
+    int start, int end,
     std::vector<Primitive*>& orderedPrims) {
     
-    BVHBuildNode* node = new BVHBuildNode;
-    (*totalNodes)++;
+    BVHBuildNode* node = arena.Alloc();
+    state.totalNodes++;
     
     // Compute bounds of all primitives
     BB bounds;
@@ -70,13 +164,7 @@ BVHBuildNode* BVHAccel::recursiveBuild(
     
     // Create leaf if few primitives
     if (nPrimitives == 1) {
-        int firstPrimOffset = orderedPrims.size();
-        for (int i = start; i < end; ++i) {
-            int primNum = primitiveInfo[i].primitiveNumber;
-            orderedPrims.push_back(primitives[primNum]);
-        }
-        node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-        return node;
+        return createLeaf(node, primitiveInfo, start, end, bounds, orderedPrims);
     }
     
     // Compute bound of primitive centroids, choose split dimension
@@ -95,18 +183,27 @@ BVHBuildNode* BVHAccel::recursiveBuild(
     
     // Partition primitives into two sets
     int mid = (start + end) / 2;
-    
-    if (splitMethod == SplitMethod::Middle) {
+
+    auto compareDim = [dim](const BVHPrimitiveInfo& a, const BVHPrimitiveInfo& b) {
+        return Coord(a.centroid, dim) < Coord(b.centroid, dim);
+    };
+
+    // Todos os centroides coincidem: não há partição espacial possível;
+    // acima de maxPrimsInNode parte-se em metades (nPrimitives dos nós tem 16 bits)
+    if (Coord(centroidBounds.max, dim) == Coord(centroidBounds.min, dim)) {
+        if (nPrimitives <= maxPrimsInNode) {
+            return createLeaf(node, primitiveInfo, start, end, bounds, orderedPrims);
+        }
+        std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
+                       &primitiveInfo[end-1]+1, compareDim);
+    } else if (splitMethod == SplitMethod::Middle) {
         // Partition primitives through node's midpoint
-        Point pmid = Centroid(centroidBounds);
-        float midCoord = (dim == 0) ? pmid.X : (dim == 1) ? pmid.Y : pmid.Z;
+        float midCoord = Coord(Centroid(centroidBounds), dim);
         
         BVHPrimitiveInfo* midPtr = std::partition(
             &primitiveInfo[start], &primitiveInfo[end-1]+1,
             [dim, midCoord](const BVHPrimitiveInfo& pi) {
-                float coord = (dim == 0) ? pi.centroid.X : 
-                             (dim == 1) ? pi.centroid.Y : pi.centroid.Z;
-                return coord < midCoord;
+                return Coord(pi.centroid, dim) < midCoord;
             });
         mid = midPtr - &primitiveInfo[0];
         
@@ -116,46 +213,110 @@ BVHBuildNode* BVHAccel::recursiveBuild(
             // Fall back to equal counts
             mid = (start + end) / 2;
             std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
-                           &primitiveInfo[end-1]+1,
-                           [dim](const BVHPrimitiveInfo& a, const BVHPrimitiveInfo& b) {
-                               float aCoord = (dim == 0) ? a.centroid.X : 
-                                            (dim == 1) ? a.centroid.Y : a.centroid.Z;
-                               float bCoord = (dim == 0) ? b.centroid.X : 
-                                            (dim == 1) ? b.centroid.Y : b.centroid.Z;
-                               return aCoord < bCoord;
-                           });
+                           &primitiveInfo[end-1]+1, compareDim);
+        }
+    } else if (splitMethod == SplitMethod::SAH && nPrimitives > 2) {
+        // Binned SAH (pbrt 3rd edition, sec 4.3.2)
+        BucketInfo buckets[nBuckets];
+        for (int i = start; i < end; ++i) {
+            int b = (int)(nBuckets * Offset(centroidBounds, primitiveInfo[i].centroid, dim));
+            if (b == nBuckets) b = nBuckets - 1;
+            buckets[b].add(primitiveInfo[i].bounds);
+        }
+        
+        // Custo de partir depois de cada bucket: varrimento da esquerda e da direita
+        float costLeft[nBuckets - 1];
+        BucketInfo acc;
+        for (int i = 0; i < nBuckets - 1; ++i) {
+            acc.add(buckets[i]);
+            costLeft[i] = acc.count ? acc.count * SurfaceArea(acc.bounds) : 0.f;
+        }
+        acc = BucketInfo();
+        const float invArea = 1.f / SurfaceArea(bounds);
+        float minCost = std::numeric_limits<float>::max();
+        int minCostSplitBucket = -1;
+        for (int i = nBuckets - 1; i > 0; --i) {
+            acc.add(buckets[i]);
+            float const costRight = acc.count ? acc.count * SurfaceArea(acc.bounds) : 0.f;
+            float const cost = SAH_TRAVERSAL_COST +
+                               SAH_INTERSECT_COST * (costLeft[i - 1] + costRight) * invArea;
+            if (cost < minCost) {
+                minCost = cost;
+                minCostSplitBucket = i - 1;
+            }
+        }
+        
+        // Criar folha se for mais barato que partir (e couber numa folha)
+        const float leafCost = SAH_INTERSECT_COST * nPrimitives;
+        if (nPrimitives > maxPrimsInNode || minCost < leafCost) {
+            BVHPrimitiveInfo* pmid = std::partition(
+                &primitiveInfo[start], &primitiveInfo[end-1]+1,
+                [=](const BVHPrimitiveInfo& pi) {
+                    int b = (int)(nBuckets * Offset(centroidBounds, pi.centroid, dim));
+                    if (b == nBuckets) b = nBuckets - 1;
+                    return b <= minCostSplitBucket;
+                });
+            mid = pmid - &primitiveInfo[0];
+            if (mid == start || mid == end) {
+                // Todos no mesmo lado (pode acontecer com bins vazios): equal counts
+                mid = (start + end) / 2;
+                std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
+                               &primitiveInfo[end-1]+1, compareDim);
+            }
+        } else {
+            return createLeaf(node, primitiveInfo, start, end, bounds, orderedPrims);
         }
     } else {
         // Equal counts
         mid = (start + end) / 2;
         std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
-                       &primitiveInfo[end-1]+1,
-                       [dim](const BVHPrimitiveInfo& a, const BVHPrimitiveInfo& b) {
-                           float aCoord = (dim == 0) ? a.centroid.X : 
-                                        (dim == 1) ? a.centroid.Y : a.centroid.Z;
-                           float bCoord = (dim == 0) ? b.centroid.X : 
-                                        (dim == 1) ? b.centroid.Y : b.centroid.Z;
-                           return aCoord < bCoord;
-                       });
+                       &primitiveInfo[end-1]+1, compareDim);
     }
     
     // Recursively build children
-    node->InitInterior(dim,
-        recursiveBuild(primitiveInfo, start, mid, totalNodes, orderedPrims),
-        recursiveBuild(primitiveInfo, mid, end, totalNodes, orderedPrims));
+    // subárvores grandes: a da esquerda é construída noutra thread, com a sua própria arena
+    BVHBuildNode* children[2];
+    if (nPrimitives >= PARALLEL_BUILD_CUTOFF && state.ReserveThread()) {
+        BuildArena* childArena = state.NewArena();
+        std::thread worker([&]() {
+            children[0] = recursiveBuild(state, *childArena, primitiveInfo, start, mid, orderedPrims);
+        });
+        children[1] = recursiveBuild(state, arena, primitiveInfo, mid, end, orderedPrims);
+        worker.join();
+        state.ReleaseThread();
+    } else {
+        children[0] = recursiveBuild(state, arena, primitiveInfo, start, mid, orderedPrims);
+        children[1] = recursiveBuild(state, arena, primitiveInfo, mid, end, orderedPrims);
+    }
+    node->InitInterior(dim, children[0], children[1]);
+    
+    return node;
+}
+
+BVHBuildNode* BVHAccel::createLeaf(
+    BVHBuildNode* node, std::vector<BVHPrimitiveInfo>& primitiveInfo,
+    int start, int end, const BB& bounds,
+    std::vector<Primitive*>& orderedPrims) {
     
+    for (int i = start; i < end; ++i) {
+        int primNum = primitiveInfo[i].primitiveNumber;
+        orderedPrims[i] = primitives[primNum];
+    }
+    node->InitLeaf(start, end - start, bounds);
     return node;
 }
 
 int BVHAccel::flattenBVHTree(BVHBuildNode* node, int* offset) {
     LinearBVHNode* linearNode = &nodes[*offset];
-    linearNode->bounds = node->bounds;
+    linearNode->SetBounds(node->bounds);
+    linearNode->pad[0] = 0;
     int myOffset = (*offset)++;
     
     if (node->nPrimitives > 0) {
         // Leaf node
         linearNode->primitivesOffset = node->firstPrimOffset;
         linearNode->nPrimitives = static_cast<uint16_t>(node->nPrimitives);
+        linearNode->axis = 0;
     } else {
         // Interior node
         linearNode->axis = static_cast<uint8_t>(node->splitAxis);
@@ -167,12 +328,25 @@ int BVHAccel::flattenBVHTree(BVHBuildNode* node, int* offset) {
     return myOffset;
 }
 
-bool BVHAccel::Intersect(const Ray& ray, Intersection* isect) const {
+bool BVHAccel::Intersect(Ray& ray, Intersection* isect) const {
     if (!nodes) return false;
     
-    bool hit = false;
-    Vector invDir(1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z);
-    int dirIsNeg[3] = { invDir.X < 0, invDir.Y < 0, invDir.Z < 0 };
+    // a travessia só guarda (t, u, v, primitiva) do hit mais próximo e
+    // encurta ray.tMax; a interseção completa é calculada no fim, uma única vez
+    PrimitiveHit hit;
+    bool found = false;
+    if (wide4) found = wide4->Intersect(ray, &hit);
+    else if (wide8) found = wide8->Intersect(ray, &hit);
+    else found = intersectBinary(ray, &hit);
+    
+    if (found) leaves->Finalize(ray, hit, isect);
+    return found;
+}
+
+bool BVHAccel::intersectBinary(Ray& ray, PrimitiveHit* hit) const {
+    bool found = false;
+    const float invDir[3] = { 1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z };
+    int dirIsNeg[3] = { invDir[0] < 0, invDir[1] < 0, invDir[2] < 0 };
     
     // Traversal stack
     int toVisitOffset = 0, currentNodeIndex = 0;
@@ -181,27 +355,10 @@ bool BVHAccel::Intersect(const Ray& ray, Intersection* isect) const {
     while (true) {
         const LinearBVHNode* node = &nodes[currentNodeIndex];
         
-        if (::IntersectP(node->bounds, ray, invDir, dirIsNeg)) {
+        if (::IntersectP(*node, ray, invDir, dirIsNeg)) {
             if (node->nPrimitives > 0) {
                 // Intersect ray with primitives in leaf BVH node
-                for (int i = 0; i < node->nPrimitives; ++i) {
-                    // Criar uma intersecção temporária
-                    Intersection temp_isect;
-                    temp_isect.pix_x = isect->pix_x;
-                    temp_isect.pix_y = isect->pix_y;
-                    
-                    // Guardar referência à primitiva
-                    Primitive* prim = primitives[node->primitivesOffset + i];
-                    
-                    if (prim->g->intersect(ray, &temp_isect)) {
-                        //Só atualizar se for mais próxima
-                        if (!hit || temp_isect.depth < isect->depth) {
-                            *isect = temp_isect;
-                            isect->f = materials[prim->material_ndx];
-                            hit = true;
-                        }
-                    }
-                }
+                if (leaves->Intersect(ray, node->primitivesOffset, node->nPrimitives, hit)) found = true;
                 if (toVisitOffset == 0) break;
                 currentNodeIndex = nodesToVisit[--toVisitOffset];
             } else {
@@ -220,15 +377,17 @@ bool BVHAccel::Intersect(const Ray& ray, Intersection* isect) const {
         }
     }
     
-    return hit;
+    return found;
 }
 
 // Shadow ray
 bool BVHAccel::IntersectP(const Ray& ray) const {
     if (!nodes) return false;
+    if (wide4) return wide4->IntersectP(ray);
+    if (wide8) return wide8->IntersectP(ray);
     
-    Vector invDir(1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z);
-    int dirIsNeg[3] = { invDir.X < 0, invDir.Y < 0, invDir.Z < 0 };
+    const float invDir[3] = { 1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z };
+    int dirIsNeg[3] = { invDir[0] < 0, invDir[1] < 0, invDir[2] < 0 };
     
     int toVisitOffset = 0, currentNodeIndex = 0;
     int nodesToVisit[64];
@@ -237,13 +396,10 @@ bool BVHAccel::IntersectP(const Ray& ray) const {
         const LinearBVHNode* node = &nodes[currentNodeIndex];
         
         // CORRIGIDO: usar função livre com :: para diferenciar
-        if (::IntersectP(node->bounds, ray, invDir, dirIsNeg)) {
+        if (::IntersectP(*node, ray, invDir, dirIsNeg)) {
             if (node->nPrimitives > 0) {
-                for (int i = 0; i < node->nPrimitives; ++i) {
-                    Intersection temp_isect;
-                    if (primitives[node->primitivesOffset + i]->g->intersect(ray, &temp_isect)) {
-                        return true;  // Early exit for shadows
-                    }
+                if (leaves->Occluded(ray, node->primitivesOffset, node->nPrimitives)) {
+                    return true;  // Early exit for shadows
                 }
                 if (toVisitOffset == 0) break;
                 currentNodeIndex = nodesToVisit[--toVisitOffset];
@@ -266,12 +422,79 @@ bool BVHAccel::IntersectP(const Ray& ray) const {
 }
 
 
-// Shadow ray test com distância máxima
-bool BVHAccel::IntersectP(const Ray& ray, float maxDist) const {
-    if (!nodes) return false;
-    
-    Vector invDir(1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z);
-    int dirIsNeg[3] = { invDir.X < 0, invDir.Y < 0, invDir.Z < 0 };
+// Frustum culling do pacote por aritmética de intervalos: devolve true se
+// nenhum raio do pacote pode atingir a caixa dentro de [tMin, tMax], o intervalo
+// que cobre os intervalos de todos os raios (só para pacotes coerentes)
+static inline bool PacketMissesBox(const LinearBVHNode& node, const RayPacket& p, float tMin, float tMax) {
+    float tNear = -std::numeric_limits<float>::max();
+    float tFar = std::numeric_limits<float>::max();
+    for (int a = 0; a < 3; ++a) {
+        const float nearPlane = node.bounds[3*p.dirIsNeg[a] + a];
+        const float farPlane = node.bounds[3*(1-p.dirIsNeg[a]) + a];
+        // (plano - o) está em [plano - oMax, plano - oMin], invDir em [invMin, invMax]
+        const float n0 = (nearPlane - p.oMax[a]) * p.invMin[a], n1 = (nearPlane - p.oMax[a]) * p.invMax[a];
+        const float n2 = (nearPlane - p.oMin[a]) * p.invMin[a], n3 = (nearPlane - p.oMin[a]) * p.invMax[a];
+        const float f0 = (farPlane - p.oMax[a]) * p.invMin[a], f1 = (farPlane - p.oMax[a]) * p.invMax[a];
+        const float f2 = (farPlane - p.oMin[a]) * p.invMin[a], f3 = (farPlane - p.oMin[a]) * p.invMax[a];
+        tNear = std::max(tNear, std::min(std::min(n0, n1), std::min(n2, n3)));
+        tFar = std::min(tFar, std::max(std::max(f0, f1), std::max(f2, f3)));
+    }
+    // comparações com NaN são falsas: na dúvida a caixa não é rejeitada
+    return tNear > tFar || tFar < tMin || tNear > tMax;
+}
+
+// Teste dos 4 raios do pacote contra a caixa de um nó; devolve a máscara
+// dos raios que a atingem dentro do seu intervalo [tMin[i], tMax[i]]
+static inline int IntersectP4(const LinearBVHNode& node, const RayPacket& p,
+                              const float tMin[RayPacket::SIZE], const float tMax[RayPacket::SIZE]) {
+#if defined(__SSE__)
+    __m128 t0 = _mm_loadu_ps(tMin);
+    __m128 t1 = _mm_loadu_ps(tMax);
+    for (int a = 0; a < 3; ++a) {
+        __m128 const o = _mm_loadu_ps(p.o[a]);
+        __m128 const inv = _mm_loadu_ps(p.invDir[a]);
+        __m128 const tA = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds[a]), o), inv);
+        __m128 const tB = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds[a + 3]), o), inv);
+        t0 = _mm_max_ps(t0, _mm_min_ps(tA, tB));
+        t1 = _mm_min_ps(t1, _mm_max_ps(tA, tB));
+    }
+    __m128 const hit = _mm_cmple_ps(t0, t1);
+    return _mm_movemask_ps(hit) & ((1 << p.n) - 1);
+#else
+    int mask = 0;
+    for (int i = 0; i < p.n; ++i) {
+        float t0 = tMin[i];
+        float t1 = tMax[i];
+        for (int a = 0; a < 3; ++a) {
+            float const tA = (node.bounds[a] - p.o[a][i]) * p.invDir[a][i];
+            float const tB = (node.bounds[a + 3] - p.o[a][i]) * p.invDir[a][i];
+            t0 = std::max(t0, std::min(tA, tB));
+            t1 = std::min(t1, std::max(tA, tB));
+        }
+        if (t0 <= t1) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// Travessia em pacote: um nó é visitado se algum raio ativo atinge a sua caixa
+// o tMax de cada raio é encurtado à medida que são encontrados hits
+int BVHAccel::Intersect4(RayPacket& packet, Intersection* isect) const {
+    if (!nodes || packet.n == 0) return 0;
+    
+    int hits = 0;
+    PrimitiveHit hit[RayPacket::SIZE];
+    // intervalos dos raios em SoA; lanes não usadas têm um intervalo vazio
+    float tMin[RayPacket::SIZE], tMax[RayPacket::SIZE];
+    float tMinPacket = MAXFLOAT, tMaxPacket = 0.f;     // intervalo que cobre todos os raios
+    for (int i = 0; i < RayPacket::SIZE; ++i) {
+        tMin[i] = (i < packet.n) ? packet.rays[i].tMin : 1.f;
+        tMax[i] = (i < packet.n) ? packet.rays[i].tMax : -1.f;
+        if (i < packet.n) {
+            tMinPacket = std::min(tMinPacket, tMin[i]);
+            tMaxPacket = std::max(tMaxPacket, tMax[i]);
+        }
+    }
     
     int toVisitOffset = 0, currentNodeIndex = 0;
     int nodesToVisit[64];
@@ -279,23 +502,28 @@ bool BVHAccel::IntersectP(const Ray& ray, float maxDist) const {
     while (true) {
         const LinearBVHNode* node = &nodes[currentNodeIndex];
         
-        if (::IntersectP(node->bounds, ray, invDir, dirIsNeg)) {
+        int mask = 0;
+        if (!packet.coherent || !PacketMissesBox(*node, packet, tMinPacket, tMaxPacket)) {
+            mask = IntersectP4(*node, packet, tMin, tMax);
+        }
+        
+        if (mask) {
             if (node->nPrimitives > 0) {
-                // Testar primitivas
-                for (int i = 0; i < node->nPrimitives; ++i) {
-                    Intersection temp_isect;
-                    if (primitives[node->primitivesOffset + i]->g->intersect(ray, &temp_isect)) {
-                        // Verificar se está dentro da distância máxima
-                        if (temp_isect.depth < maxDist) {
-                            return true;  // Bloqueado!
-                        }
+                for (int i = 0; i < packet.n; ++i) {
+                    if (!(mask & (1 << i))) continue;
+                    if (leaves->Intersect(packet.rays[i], node->primitivesOffset, node->nPrimitives, &hit[i])) {
+                        hits |= 1 << i;
+                        tMax[i] = packet.rays[i].tMax;
                     }
                 }
+                tMaxPacket = tMax[0];
+                for (int i = 1; i < packet.n; ++i) tMaxPacket = std::max(tMaxPacket, tMax[i]);
+                
                 if (toVisitOffset == 0) break;
                 currentNodeIndex = nodesToVisit[--toVisitOffset];
             } else {
-                // Interior node...
-                if (dirIsNeg[node->axis]) {
+                // ordem de travessia pelo sinal da direção do pacote
+                if (packet.dirIsNeg[node->axis]) {
                     nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
                     currentNodeIndex = node->secondChildOffset;
                 } else {
@@ -309,5 +537,8 @@ bool BVHAccel::IntersectP(const Ray& ray, float maxDist) const {
         }
     }
     
-    return false;  // Não bloqueado
-}
\ No newline at end of file
+    for (int i = 0; i < packet.n; ++i) {
+        if (hits & (1 << i)) leaves->Finalize(packet.rays[i], hit[i], &isect[i]);
+    }
+    return hits;
+}
@@ -4,9 +4,15 @@
 #include "primitive.hpp"
 #include "BB_extensions.hpp"
 #include "ray.hpp"
+#include "RayPacket.hpp"
+#include "TriangleBlock.hpp"
 #include "intersection.hpp"
 #include <vector>
 #include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <thread>
 
 enum class SplitMethod { 
     SAH,           // Surface Area Heuristic (padrão)
@@ -14,6 +20,15 @@ enum class SplitMethod {
     EqualCounts    // Partições iguais
 };
 
+// Layout do BVH usado na travessia
+enum class BVHLayout {
+    Binary,        // BVH binário (LinearBVHNode)
+    Wide4,         // QBVH: 4 filhos por nó, teste SSE
+    Wide8          // OBVH: 8 filhos por nó, teste AVX
+};
+
+template <int N> class WideBVH;
+
 // Info da primitiva durante construção (PBR book)
 struct BVHPrimitiveInfo {
     size_t primitiveNumber;
@@ -25,6 +40,30 @@ struct BVHPrimitiveInfo {
           centroid(Centroid(bounds)) {}
 };
 
+// Custos relativos usados pelo SAH (pbrt 3rd edition, sec 4.3.2)
+static const int nBuckets = 12;
+static const float SAH_TRAVERSAL_COST = 0.125f;
+static const float SAH_INTERSECT_COST = 1.f;
+
+// Bucket do SAH binned: nº de primitivas e caixa que as envolve
+struct BucketInfo {
+    int count;
+    BB bounds;
+    
+    BucketInfo() : count(0) {}
+    
+    // BB() é (0,0,0)-(0,0,0), por isso o primeiro elemento inicializa a caixa
+    void add(const BB& b) {
+        bounds = count ? Union(bounds, b) : b;
+        count++;
+    }
+    void add(const BucketInfo& other) {
+        if (other.count == 0) return;
+        bounds = count ? Union(bounds, other.bounds) : other.bounds;
+        count += other.count;
+    }
+};
+
 // Node da construção (temporário, PBR book)
 struct BVHBuildNode {
     BB bounds;
@@ -47,9 +86,60 @@ struct BVHBuildNode {
     }
 };
 
-// Node final linear
-struct LinearBVHNode {
-    BB bounds;
+// Arena para os BVHBuildNode: aloca em blocos e liberta tudo de uma vez
+// (não é thread-safe: cada thread de construção usa a sua)
+class BuildArena {
+    static const int BLOCK_SIZE = 4096;
+    std::vector<BVHBuildNode*> blocks;
+    int used;
+public:
+    BuildArena() : used(BLOCK_SIZE) {}
+    ~BuildArena() {
+        for (auto b : blocks) delete[] b;
+    }
+    BVHBuildNode* Alloc() {
+        if (used == BLOCK_SIZE) {
+            blocks.push_back(new BVHBuildNode[BLOCK_SIZE]);
+            used = 0;
+        }
+        return &blocks.back()[used++];
+    }
+};
+
+// Subárvores com pelo menos este nº de primitivas podem ser construídas noutra thread
+static const int PARALLEL_BUILD_CUTOFF = 16384;
+
+// Estado partilhado pelas threads durante a construção
+struct BVHBuildState {
+    std::atomic<int> totalNodes;
+    std::atomic<int> freeThreads;    // threads extra que ainda podem ser lançadas
+    std::mutex arenasLock;
+    std::vector<std::unique_ptr<BuildArena>> arenas;
+    
+    BVHBuildState() : totalNodes(0) {
+        int hw = (int)std::thread::hardware_concurrency();
+        freeThreads = (hw > 1) ? hw - 1 : 0;
+    }
+    bool ReserveThread() {
+        int n = freeThreads.load();
+        while (n > 0) {
+            if (freeThreads.compare_exchange_weak(n, n - 1)) return true;
+        }
+        return false;
+    }
+    void ReleaseThread() { freeThreads++; }
+    BuildArena* NewArena() {
+        std::lock_guard<std::mutex> guard(arenasLock);
+        arenas.push_back(std::unique_ptr<BuildArena>(new BuildArena));
+        return arenas.back().get();
+    }
+};
+
+// Node final linear: 32 bytes, alinhado a 32 (dois nós por linha de cache de 64 bytes)
+// bounds = {min.X, min.Y, min.Z, max.X, max.Y, max.Z}, o que permite escolher
+// o plano próximo/afastado de cada eixo por índice: bounds[3*dirIsNeg[a] + a]
+struct alignas(32) LinearBVHNode {
+    float bounds[6];
     union {
         int primitivesOffset;    // leaf
         int secondChildOffset;   // interior 
@@ -58,12 +148,53 @@ struct LinearBVHNode {
     uint8_t axis;          // split axis
     uint8_t pad[1];        // alinhamento
     
-    // Construtor padrão
-    LinearBVHNode() : nPrimitives(0), axis(0) {
-        pad[0] = 0;
-        primitivesOffset = 0;
+    void SetBounds(const BB& b) {
+        bounds[0] = b.min.X; bounds[1] = b.min.Y; bounds[2] = b.min.Z;
+        bounds[3] = b.max.X; bounds[4] = b.max.Y; bounds[5] = b.max.Z;
+    }
+    BB Bounds() const {
+        BB b;
+        b.min.set(bounds[0], bounds[1], bounds[2]);
+        b.max.set(bounds[3], bounds[4], bounds[5]);
+        return b;
     }
 };
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode must be 32 bytes");
+
+// Alinhamento do array de nós (linha de cache)
+static const size_t BVH_NODE_ALIGNMENT = 64;
+
+// Teste raio/caixa de um nó (slabs, como ::IntersectP(const BB&, ...))
+// invDir e dirIsNeg são calculados uma vez por raio; só conta a parte da caixa
+// dentro do intervalo [ray.tMin, ray.tMax]
+inline bool IntersectP(const LinearBVHNode& node, const Ray& ray, const float invDir[3],
+                       const int dirIsNeg[3]) {
+    const float* b = node.bounds;
+    
+    // X slab
+    float tMin = (b[3*dirIsNeg[0]] - ray.o.X) * invDir[0];
+    float tMax = (b[3*(1-dirIsNeg[0])] - ray.o.X) * invDir[0];
+    
+    // Y slab
+    float tyMin = (b[3*dirIsNeg[1] + 1] - ray.o.Y) * invDir[1];
+    float tyMax = (b[3*(1-dirIsNeg[1]) + 1] - ray.o.Y) * invDir[1];
+    
+    if (tMin > tyMax || tyMin > tMax) return false;
+    
+    tMin = std::max(tMin, tyMin);
+    tMax = std::min(tMax, tyMax);
+    
+    // Z slab
+    float tzMin = (b[3*dirIsNeg[2] + 2] - ray.o.Z) * invDir[2];
+    float tzMax = (b[3*(1-dirIsNeg[2]) + 2] - ray.o.Z) * invDir[2];
+    
+    if (tMin > tzMax || tzMin > tMax) return false;
+    
+    tMin = std::max(tMin, tzMin);
+    tMax = std::min(tMax, tzMax);
+    
+    return (tMin < ray.tMax) && (tMax > ray.tMin);
+}
 
 class BVHAccel {
 private:
@@ -71,27 +202,45 @@ private:
     SplitMethod splitMethod;
     std::vector<Primitive*> primitives;
     LinearBVHNode* nodes;
+    int totalNodes;
     BRDF** materials;
+    LeafPrimitives* leaves;   // primitivas das folhas (triângulos em blocos SoA)
+    WideBVH<4>* wide4;     // != nullptr se layout == Wide4
+    WideBVH<8>* wide8;     // != nullptr se layout == Wide8
     
     // Métodos de construção (PBR book)
     BVHBuildNode* recursiveBuild(
+        BVHBuildState& state, BuildArena& arena,
         std::vector<BVHPrimitiveInfo>& primitiveInfo,
-        int start, int end, int* totalNodes,
+        int start, int end,
+        std::vector<Primitive*>& orderedPrims);
+    
+    BVHBuildNode* createLeaf(
+        BVHBuildNode* node, std::vector<BVHPrimitiveInfo>& primitiveInfo,
+        int start, int end, const BB& bounds,
         std::vector<Primitive*>& orderedPrims);
     
     int flattenBVHTree(BVHBuildNode* node, int* offset);
     
+    // travessia do BVH binário; atualiza hit com o mais próximo
+    bool intersectBinary(Ray& ray, PrimitiveHit* hit) const;
+    
 public:
     BVHAccel(std::vector<Primitive*>& p,
              BRDF** mats, 
              int maxPrimsInNode = 4,
-             SplitMethod splitMethod = SplitMethod::SAH);
+             SplitMethod splitMethod = SplitMethod::SAH,
+             BVHLayout layout = BVHLayout::Binary);
     ~BVHAccel();
     
-    bool Intersect(const Ray& ray, Intersection* isect) const;
+    // closest hit in [ray.tMin, ray.tMax]; on return ray.tMax is the hit distance
+    bool Intersect(Ray& ray, Intersection* isect) const;
+    // any hit in [ray.tMin, ray.tMax] (shadow rays)
     bool IntersectP(const Ray& ray) const; 
     
-    bool IntersectP(const Ray& ray, float maxDist) const;
+    // closest hit for a packet of coherent rays (always on the binary BVH)
+    // isect[i] is filled for each ray i in the returned hit mask
+    int Intersect4(RayPacket& packet, Intersection* isect) const;
     
     void printStats() const;
 };
@@ -0,0 +1,254 @@
+#ifndef TRIANGLEBLOCK_HPP
+#define TRIANGLEBLOCK_HPP
+
+#include "primitive.hpp"
+#include "triangle.hpp"
+#include "ray.hpp"
+#include "intersection.hpp"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+// 4 triângulos de uma folha guardados em SoA, para serem testados de uma vez
+// com Moller-Trumbore SIMD: v0[a][i] = coordenada a do vértice 1 do triângulo i,
+// e1/e2 = arestas v1->v2 e v1->v3, n = normal geométrica (só para o backface culling)
+// Lanes vazias têm tudo a 0 e prim = -1: par = 0 rejeita-as sempre
+struct alignas(16) TriangleBlock4 {
+    float v0[3][4];
+    float e1[3][4];
+    float e2[3][4];
+    float n[3][4];
+    float cull[4];     // 1 = BackFaceCulling
+    int prim[4];       // índice em primitives, -1 = lane vazia
+};
+
+// Moller-Trumbore (mesmo cálculo que Triangle::intersect) contra os 4 triângulos
+// devolve a máscara das lanes atingidas com ray.tMin < t < ray.tMax e escreve t, u, v
+inline int IntersectBlock4(const TriangleBlock4& b, const Ray& ray,
+                           float t[4], float u[4], float v[4]) {
+#if defined(__SSE__)
+    const __m128 dX = _mm_set1_ps(ray.dir.X), dY = _mm_set1_ps(ray.dir.Y), dZ = _mm_set1_ps(ray.dir.Z);
+    const __m128 e1X = _mm_load_ps(b.e1[0]), e1Y = _mm_load_ps(b.e1[1]), e1Z = _mm_load_ps(b.e1[2]);
+    const __m128 e2X = _mm_load_ps(b.e2[0]), e2Y = _mm_load_ps(b.e2[1]), e2Z = _mm_load_ps(b.e2[2]);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f), eps = _mm_set1_ps(EPSILON);
+
+    // backface culling : par = n . dir
+    const __m128 par = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(b.n[0]), dX),
+                                             _mm_mul_ps(_mm_load_ps(b.n[1]), dY)),
+                                  _mm_mul_ps(_mm_load_ps(b.n[2]), dZ));
+    const __m128 culled = _mm_cmpgt_ps(_mm_load_ps(b.cull), zero);
+    const __m128 absPar = _mm_andnot_ps(_mm_set1_ps(-0.f), par);
+    __m128 ok = _mm_or_ps(_mm_and_ps(culled, _mm_cmple_ps(par, _mm_sub_ps(zero, eps))),
+                          _mm_andnot_ps(culled, _mm_cmpge_ps(absPar, eps)));
+
+    // h = dir x e2
+    const __m128 hX = _mm_sub_ps(_mm_mul_ps(dY, e2Z), _mm_mul_ps(dZ, e2Y));
+    const __m128 hY = _mm_sub_ps(_mm_mul_ps(dZ, e2X), _mm_mul_ps(dX, e2Z));
+    const __m128 hZ = _mm_sub_ps(_mm_mul_ps(dX, e2Y), _mm_mul_ps(dY, e2X));
+    const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1X, hX), _mm_mul_ps(e1Y, hY)), _mm_mul_ps(e1Z, hZ));
+    const __m128 f = _mm_div_ps(one, a);
+
+    // s = o - v0
+    const __m128 sX = _mm_sub_ps(_mm_set1_ps(ray.o.X), _mm_load_ps(b.v0[0]));
+    const __m128 sY = _mm_sub_ps(_mm_set1_ps(ray.o.Y), _mm_load_ps(b.v0[1]));
+    const __m128 sZ = _mm_sub_ps(_mm_set1_ps(ray.o.Z), _mm_load_ps(b.v0[2]));
+    const __m128 U = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, hX), _mm_mul_ps(sY, hY)), _mm_mul_ps(sZ, hZ)));
+    ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpge_ps(U, zero), _mm_cmple_ps(U, one)));
+
+    // q = s x e1
+    const __m128 qX = _mm_sub_ps(_mm_mul_ps(sY, e1Z), _mm_mul_ps(sZ, e1Y));
+    const __m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, e1X), _mm_mul_ps(sX, e1Z));
+    const __m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, e1Y), _mm_mul_ps(sY, e1X));
+    const __m128 V = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dX, qX), _mm_mul_ps(dY, qY)), _mm_mul_ps(dZ, qZ)));
+    ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpge_ps(V, zero), _mm_cmple_ps(_mm_add_ps(U, V), one)));
+
+    const __m128 T = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2X, qX), _mm_mul_ps(e2Y, qY)), _mm_mul_ps(e2Z, qZ)));
+    ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpgt_ps(T, _mm_set1_ps(ray.tMin)), _mm_cmplt_ps(T, _mm_set1_ps(ray.tMax))));
+
+    _mm_storeu_ps(t, T);
+    _mm_storeu_ps(u, U);
+    _mm_storeu_ps(v, V);
+    return _mm_movemask_ps(ok);
+#else
+    int mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        const float par = b.n[0][i] * ray.dir.X + b.n[1][i] * ray.dir.Y + b.n[2][i] * ray.dir.Z;
+        if ((b.cull[i] > 0.f && par > -EPSILON) || (b.cull[i] <= 0.f && std::abs(par) < EPSILON)) continue;
+
+        const float hX = ray.dir.Y * b.e2[2][i] - ray.dir.Z * b.e2[1][i];
+        const float hY = ray.dir.Z * b.e2[0][i] - ray.dir.X * b.e2[2][i];
+        const float hZ = ray.dir.X * b.e2[1][i] - ray.dir.Y * b.e2[0][i];
+        const float f = 1.f / (b.e1[0][i] * hX + b.e1[1][i] * hY + b.e1[2][i] * hZ);
+        const float sX = ray.o.X - b.v0[0][i], sY = ray.o.Y - b.v0[1][i], sZ = ray.o.Z - b.v0[2][i];
+        u[i] = f * (sX * hX + sY * hY + sZ * hZ);
+        if (u[i] < 0.f || u[i] > 1.f) continue;
+
+        const float qX = sY * b.e1[2][i] - sZ * b.e1[1][i];
+        const float qY = sZ * b.e1[0][i] - sX * b.e1[2][i];
+        const float qZ = sX * b.e1[1][i] - sY * b.e1[0][i];
+        v[i] = f * (ray.dir.X * qX + ray.dir.Y * qY + ray.dir.Z * qZ);
+        if (v[i] < 0.f || u[i] + v[i] > 1.f) continue;
+
+        t[i] = f * (b.e2[0][i] * qX + b.e2[1][i] * qY + b.e2[2][i] * qZ);
+        if (t[i] > ray.tMin && t[i] < ray.tMax) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// Hit mais próximo durante a travessia: distância, coordenadas (u,v) na
+// superfície e índice da primitiva (-1 = nenhum)
+struct PrimitiveHit {
+    float t, u, v;
+    int prim;
+
+    PrimitiveHit() : t(MAXFLOAT), u(0.f), v(0.f), prim(-1) {}
+};
+
+// Primitivas das folhas do BVH: os triângulos de cada folha ficam no início
+// do seu intervalo [first, first+count[ e são copiados para blocos SoA de 4;
+// as restantes geometrias (esferas, ...) continuam a ser testadas uma a uma
+class LeafPrimitives {
+    struct LeafTriangles {
+        int firstBlock;
+        int nTris;
+    };
+
+    const std::vector<Primitive*>& primitives;
+    BRDF** materials;
+    TriangleBlock4* blocks;
+    int nBlocks;
+    std::vector<LeafTriangles> leafOf;    // indexado pelo primeiro offset de cada folha
+
+public:
+    LeafPrimitives(const std::vector<Primitive*>& prims, BRDF** mats)
+        : primitives(prims), materials(mats), blocks(nullptr), nBlocks(0) {}
+    ~LeafPrimitives() { free(blocks); }
+
+    // prims tem de ser o mesmo vetor passado ao construtor: o intervalo de cada
+    // folha é reordenado (triângulos primeiro) antes de criar os blocos
+    // leaves: pares (first, count) de todas as folhas
+    void Build(std::vector<Primitive*>& prims, const std::vector<std::pair<int, int>>& leaves) {
+        leafOf.assign(prims.size(), LeafTriangles{0, 0});
+
+        int total = 0;
+        for (const auto& l : leaves) {
+            Primitive** begin = prims.data() + l.first;
+            Primitive** mid = std::stable_partition(begin, begin + l.second, [](Primitive* p) {
+                return dynamic_cast<Triangle*>(p->g) != nullptr;
+            });
+            leafOf[l.first].firstBlock = total;
+            leafOf[l.first].nTris = (int)(mid - begin);
+            total += (leafOf[l.first].nTris + 3) / 4;
+        }
+
+        free(blocks);
+        blocks = nullptr;
+        nBlocks = total;
+        if (nBlocks == 0) return;
+        void* mem = nullptr;
+        if (posix_memalign(&mem, 64, sizeof(TriangleBlock4) * nBlocks) != 0) {
+            throw std::bad_alloc();
+        }
+        blocks = static_cast<TriangleBlock4*>(mem);
+
+        for (const auto& l : leaves) {
+            const LeafTriangles& lt = leafOf[l.first];
+            for (int k = 0; k < (lt.nTris + 3) / 4; ++k) {
+                TriangleBlock4& b = blocks[lt.firstBlock + k];
+                for (int i = 0; i < 4; ++i) {
+                    const int j = 4 * k + i;
+                    if (j >= lt.nTris) {
+                        for (int a = 0; a < 3; ++a) b.v0[a][i] = b.e1[a][i] = b.e2[a][i] = b.n[a][i] = 0.f;
+                        b.cull[i] = 0.f;
+                        b.prim[i] = -1;
+                        continue;
+                    }
+                    const Triangle* tri = static_cast<const Triangle*>(prims[l.first + j]->g);
+                    b.v0[0][i] = tri->v1.X;    b.v0[1][i] = tri->v1.Y;    b.v0[2][i] = tri->v1.Z;
+                    b.e1[0][i] = tri->edge1.X; b.e1[1][i] = tri->edge1.Y; b.e1[2][i] = tri->edge1.Z;
+                    b.e2[0][i] = tri->edge2.X; b.e2[1][i] = tri->edge2.Y; b.e2[2][i] = tri->edge2.Z;
+                    b.n[0][i] = tri->normal.X; b.n[1][i] = tri->normal.Y; b.n[2][i] = tri->normal.Z;
+                    b.cull[i] = tri->BackFaceCulling ? 1.f : 0.f;
+                    b.prim[i] = l.first + j;
+                }
+            }
+        }
+    }
+
+    // interseta as primitivas de uma folha; atualiza hit se houver uma mais próxima
+    // e encurta ray.tMax para a distância desse hit
+    // (só t, u, v e o índice da primitiva: isect é preenchido uma vez, em Finalize)
+    bool Intersect(Ray& ray, int first, int count, PrimitiveHit* hit) const {
+        const LeafTriangles& lt = leafOf[first];
+        bool found = false;
+
+        for (int k = 0; k < (lt.nTris + 3) / 4; ++k) {
+            const TriangleBlock4& b = blocks[lt.firstBlock + k];
+            float t[4], u[4], v[4];
+            int mask = IntersectBlock4(b, ray, t, u, v);
+            for (int i = 0; mask != 0; ++i, mask >>= 1) {
+                if ((mask & 1) && t[i] < ray.tMax) {
+                    ray.tMax = hit->t = t[i];
+                    hit->u = u[i];
+                    hit->v = v[i];
+                    hit->prim = b.prim[i];
+                    found = true;
+                }
+            }
+        }
+
+        for (int i = lt.nTris; i < count; ++i) {
+            float t, u, v;
+            if (primitives[first + i]->g->intersectT(ray, &t, &u, &v)) {
+                ray.tMax = hit->t = t;
+                hit->u = u;
+                hit->v = v;
+                hit->prim = first + i;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // algum hit numa folha dentro de [ray.tMin, ray.tMax] ?
+    // os emissores não bloqueiam raios de sombra (tal como com o BVH de luzes separado)
+    bool Occluded(const Ray& ray, int first, int count) const {
+        const LeafTriangles& lt = leafOf[first];
+        for (int k = 0; k < (lt.nTris + 3) / 4; ++k) {
+            const TriangleBlock4& b = blocks[lt.firstBlock + k];
+            float t[4], u[4], v[4];
+            int mask = IntersectBlock4(b, ray, t, u, v);
+            for (int i = 0; mask != 0; ++i, mask >>= 1) {
+                if ((mask & 1) && primitives[b.prim[i]]->light_ndx < 0) return true;
+            }
+        }
+        for (int i = lt.nTris; i < count; ++i) {
+            float t, u, v;
+            if (primitives[first + i]->light_ndx >= 0) continue;
+            if (primitives[first + i]->g->intersectT(ray, &t, &u, &v)) return true;
+        }
+        return false;
+    }
+
+    // preenche isect com o hit mais próximo encontrado pela travessia
+    // emissores (light_ndx >= 0) não têm material: isect indica só qual a luz
+    void Finalize(const Ray& ray, const PrimitiveHit& hit, Intersection* isect) const {
+        Primitive* prim = primitives[hit.prim];
+        prim->g->computeSurfaceInteraction(ray, hit.t, hit.u, hit.v, isect);
+        isect->light_ndx = prim->light_ndx;
+        isect->isLight = (prim->light_ndx >= 0);
+        isect->f = isect->isLight ? nullptr : materials[prim->material_ndx];
+    }
+
+    int BlockCount() const { return nBlocks; }
+};
+
+#endif
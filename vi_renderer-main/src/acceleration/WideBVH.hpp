@@ -0,0 +1,282 @@
+#ifndef WIDEBVH_HPP
+#define WIDEBVH_HPP
+
+#include "BVHAccel.hpp"
+#include <vector>
+#include <limits>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SSE__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// BVH largo (QBVH com N=4, OBVH com N=8), obtido colapsando o BVH binário.
+// As caixas dos N filhos estão guardadas em SoA, para que um único teste de
+// slabs SIMD teste todos os filhos de uma vez:
+//   bounds[0..2][i] = min X,Y,Z do filho i ; bounds[3..5][i] = max X,Y,Z
+template <int N>
+struct alignas(32) WideBVHNode {
+    float bounds[6][N];
+    int child[N];          // interior: índice do nó largo ; folha: primeira primitiva
+    uint16_t nPrims[N];    // 0 = filho interior
+    int nChildren;
+};
+
+// Teste de slabs dos N filhos contra o raio, recortado ao intervalo [tMin, tMax]
+// do raio; devolve a máscara dos filhos atingidos e escreve tNear de cada filho
+template <int N>
+inline int IntersectChildren(const WideBVHNode<N>& node, const float o[3], const float invDir[3],
+                             float tMin, float tMax, float tNear[N]) {
+    int mask = 0;
+    for (int i = 0; i < node.nChildren; ++i) {
+        float t0 = tMin;
+        float t1 = tMax;
+        for (int a = 0; a < 3; ++a) {
+            float const tA = (node.bounds[a][i] - o[a]) * invDir[a];
+            float const tB = (node.bounds[a + 3][i] - o[a]) * invDir[a];
+            t0 = std::max(t0, std::min(tA, tB));
+            t1 = std::min(t1, std::max(tA, tB));
+        }
+        tNear[i] = t0;
+        if (t0 <= t1) mask |= 1 << i;
+    }
+    return mask;
+}
+
+#if defined(__SSE__)
+// QBVH: 4 filhos num registo SSE
+template <>
+inline int IntersectChildren<4>(const WideBVHNode<4>& node, const float o[3], const float invDir[3],
+                                float tMin, float tMax, float tNear[4]) {
+    __m128 t0 = _mm_set1_ps(tMin);
+    __m128 t1 = _mm_set1_ps(tMax);
+    for (int a = 0; a < 3; ++a) {
+        __m128 const oa = _mm_set1_ps(o[a]);
+        __m128 const ia = _mm_set1_ps(invDir[a]);
+        __m128 const tA = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds[a]), oa), ia);
+        __m128 const tB = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds[a + 3]), oa), ia);
+        t0 = _mm_max_ps(t0, _mm_min_ps(tA, tB));
+        t1 = _mm_min_ps(t1, _mm_max_ps(tA, tB));
+    }
+    _mm_storeu_ps(tNear, t0);
+    __m128 const hit = _mm_cmple_ps(t0, t1);
+    return _mm_movemask_ps(hit) & ((1 << node.nChildren) - 1);
+}
+#endif
+
+#if defined(__AVX__)
+// OBVH: 8 filhos num registo AVX
+template <>
+inline int IntersectChildren<8>(const WideBVHNode<8>& node, const float o[3], const float invDir[3],
+                                float tMin, float tMax, float tNear[8]) {
+    __m256 t0 = _mm256_set1_ps(tMin);
+    __m256 t1 = _mm256_set1_ps(tMax);
+    for (int a = 0; a < 3; ++a) {
+        __m256 const oa = _mm256_set1_ps(o[a]);
+        __m256 const ia = _mm256_set1_ps(invDir[a]);
+        __m256 const tA = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.bounds[a]), oa), ia);
+        __m256 const tB = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.bounds[a + 3]), oa), ia);
+        t0 = _mm256_max_ps(t0, _mm256_min_ps(tA, tB));
+        t1 = _mm256_min_ps(t1, _mm256_max_ps(tA, tB));
+    }
+    _mm256_storeu_ps(tNear, t0);
+    __m256 const hit = _mm256_cmp_ps(t0, t1, _CMP_LE_OQ);
+    return _mm256_movemask_ps(hit) & ((1 << node.nChildren) - 1);
+}
+#endif
+
+template <int N>
+class WideBVH {
+private:
+    WideBVHNode<N>* nodes;
+    int totalNodes;
+    const LeafPrimitives& leaves;   // primitivas das folhas (as mesmas do BVH binário)
+
+    // entrada da pilha de travessia: nó largo e distância de entrada na sua caixa
+    struct StackEntry {
+        int node;
+        float tNear;
+    };
+    static const int STACK_SIZE = 64 * N;
+
+    // Colapsa a subárvore binária com raiz em binIndex (nó interior) num nó largo
+    int collapse(const LinearBVHNode* bin, int binIndex, std::vector<WideBVHNode<N>>& out) {
+        // filhos candidatos: abrir o filho interior com maior área até ter N filhos
+        int children[N];
+        int n = 0;
+        children[n++] = binIndex + 1;
+        children[n++] = bin[binIndex].secondChildOffset;
+        while (n < N) {
+            int best = -1;
+            float bestArea = -1.f;
+            for (int i = 0; i < n; ++i) {
+                const LinearBVHNode& c = bin[children[i]];
+                if (c.nPrimitives == 0) {
+                    float const area = SurfaceArea(c.Bounds());
+                    if (area > bestArea) {
+                        bestArea = area;
+                        best = i;
+                    }
+                }
+            }
+            if (best < 0) break;   // só restam folhas
+            int const opened = children[best];
+            children[best] = opened + 1;
+            children[n++] = bin[opened].secondChildOffset;
+        }
+
+        int const myIndex = (int)out.size();
+        out.push_back(WideBVHNode<N>());
+
+        // Slots vazios: caixa invertida, nunca são atingidos
+        WideBVHNode<N> node;
+        for (int i = 0; i < N; ++i) {
+            for (int a = 0; a < 3; ++a) {
+                node.bounds[a][i] = std::numeric_limits<float>::max();
+                node.bounds[a + 3][i] = -std::numeric_limits<float>::max();
+            }
+            node.child[i] = -1;
+            node.nPrims[i] = 0;
+        }
+        node.nChildren = n;
+
+        for (int i = 0; i < n; ++i) {
+            const LinearBVHNode& c = bin[children[i]];
+            for (int a = 0; a < 6; ++a) node.bounds[a][i] = c.bounds[a];
+            if (c.nPrimitives > 0) {
+                node.child[i] = c.primitivesOffset;
+                node.nPrims[i] = c.nPrimitives;
+            } else {
+                node.child[i] = collapse(bin, children[i], out);
+            }
+        }
+        out[myIndex] = node;
+        return myIndex;
+    }
+
+public:
+    // root: raiz do BVH binário (nó 0 de bin)
+    WideBVH(const LinearBVHNode* bin, const LeafPrimitives& _leaves)
+        : nodes(nullptr), totalNodes(0), leaves(_leaves) {
+        std::vector<WideBVHNode<N>> out;
+        if (bin[0].nPrimitives > 0) {
+            // árvore com uma só folha: raiz com um filho
+            WideBVHNode<N> node;
+            for (int i = 0; i < N; ++i) {
+                for (int a = 0; a < 3; ++a) {
+                    node.bounds[a][i] = std::numeric_limits<float>::max();
+                    node.bounds[a + 3][i] = -std::numeric_limits<float>::max();
+                }
+                node.child[i] = -1;
+                node.nPrims[i] = 0;
+            }
+            for (int a = 0; a < 6; ++a) node.bounds[a][0] = bin[0].bounds[a];
+            node.child[0] = bin[0].primitivesOffset;
+            node.nPrims[0] = bin[0].nPrimitives;
+            node.nChildren = 1;
+            out.push_back(node);
+        } else {
+            collapse(bin, 0, out);
+        }
+
+        totalNodes = (int)out.size();
+        void* mem = nullptr;
+        if (posix_memalign(&mem, BVH_NODE_ALIGNMENT, sizeof(WideBVHNode<N>) * totalNodes) != 0) {
+            throw std::bad_alloc();
+        }
+        nodes = static_cast<WideBVHNode<N>*>(mem);
+        std::copy(out.begin(), out.end(), nodes);
+    }
+    ~WideBVH() { free(nodes); }
+
+    // Travessia ordenada: os filhos atingidos são visitados por ordem de tNear
+    // e são ignorados os que começam depois do hit mais próximo encontrado
+    // hit: mais próximo encontrado; ray.tMax é encurtado a cada hit e limita a travessia
+    bool Intersect(Ray& ray, PrimitiveHit* hit) const {
+        const float o[3] = { ray.o.X, ray.o.Y, ray.o.Z };
+        const float invDir[3] = { 1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z };
+
+        bool found = false;
+        StackEntry stack[STACK_SIZE];
+        int top = 0;
+        stack[top].node = 0;
+        stack[top++].tNear = ray.tMin;
+
+        while (top > 0) {
+            const StackEntry e = stack[--top];
+            if (e.tNear > ray.tMax) continue;
+
+            const WideBVHNode<N>& node = nodes[e.node];
+            float tNear[N];
+            int mask = IntersectChildren<N>(node, o, invDir, ray.tMin, ray.tMax, tNear);
+            if (mask == 0) continue;
+
+            // ordenar os filhos atingidos por tNear (inserção, N <= 8)
+            int order[N], nHit = 0;
+            for (int i = 0; i < node.nChildren; ++i) {
+                if (!(mask & (1 << i))) continue;
+                int j = nHit++;
+                while (j > 0 && tNear[order[j - 1]] > tNear[i]) {
+                    order[j] = order[j - 1];
+                    --j;
+                }
+                order[j] = i;
+            }
+
+            // folhas: intersetar já, da mais próxima para a mais afastada
+            for (int k = 0; k < nHit; ++k) {
+                int const i = order[k];
+                if (node.nPrims[i] > 0 && tNear[i] <= ray.tMax) {
+                    if (leaves.Intersect(ray, node.child[i], node.nPrims[i], hit)) found = true;
+                }
+            }
+            // interiores: empilhar do mais afastado para o mais próximo
+            for (int k = nHit - 1; k >= 0; --k) {
+                int const i = order[k];
+                if (node.nPrims[i] == 0 && tNear[i] <= ray.tMax) {
+                    stack[top].node = node.child[i];
+                    stack[top++].tNear = tNear[i];
+                }
+            }
+        }
+        return found;
+    }
+
+    // Shadow ray: qualquer hit em [ray.tMin, ray.tMax]
+    bool IntersectP(const Ray& ray) const {
+        const float o[3] = { ray.o.X, ray.o.Y, ray.o.Z };
+        const float invDir[3] = { 1.0f / ray.dir.X, 1.0f / ray.dir.Y, 1.0f / ray.dir.Z };
+
+        int stack[STACK_SIZE];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            const WideBVHNode<N>& node = nodes[stack[--top]];
+            float tNear[N];
+            int mask = IntersectChildren<N>(node, o, invDir, ray.tMin, ray.tMax, tNear);
+            for (int i = 0; mask != 0; ++i, mask >>= 1) {
+                if (!(mask & 1)) continue;
+                if (node.nPrims[i] > 0) {
+                    if (leaves.Occluded(ray, node.child[i], node.nPrims[i])) return true;
+                } else {
+                    stack[top++] = node.child[i];
+                }
+            }
+        }
+        return false;
+    }
+
+    int NodeCount() const { return totalNodes; }
+
+    void printStats() const {
+        long slots = 0;
+        for (int i = 0; i < totalNodes; ++i) slots += nodes[i].nChildren;
+        const size_t bytes = sizeof(WideBVHNode<N>) * (size_t)totalNodes;
+        fprintf(stdout, "           %d-wide BVH: %d nodes, %.2f children/node, %zu bytes/node, %.2f MB\n",
+                N, totalNodes, (float)slots / totalNodes, sizeof(WideBVHNode<N>), bytes / (1024. * 1024.));
+    }
+};
+
+#endif
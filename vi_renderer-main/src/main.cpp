@@ -13,7 +13,15 @@
 #include "FisheyeCamera.hpp" 
 #include "DummyRenderer.hpp"
 #include "StandardRenderer.hpp"
+#include "ParallelRenderer.hpp"
+#include "WavefrontRenderer.hpp"
+#include "AdaptiveRenderer.hpp"
+#include "ProgressiveRenderer.hpp"
+#include "IndependentSampler.hpp"
+#include "SobolSampler.hpp"
 #include "ImagePPM.hpp"
+#include "ImagePFM.hpp"
+#include "ImageHDR.hpp"
 #include "AmbientShader.hpp"
 #include "WhittedShader.hpp"
 #include "DistributedShader.hpp"
@@ -22,22 +30,18 @@
 #include "Sphere.hpp"
 #include "BuildScenes.hpp"
 #include <time.h>
+#include <chrono>
+#include <vector>
+#include <string>
 
-// ============================================
-// TONE MAPPER INCLUDES 
-// ============================================
-#include "ToneMapper/ReinhardBasic.hpp"
-#include "ToneMapper/ReinhardAdvanced.hpp"
-#include "ToneMapper/ACES.hpp"
-#include "ToneMapper/Exposure.hpp"
-#include "ToneMapper/Linear.hpp"
+#include "PostProcess.hpp"
 
 int main(int argc, const char * argv[]) {
     Scene scene;
     ImagePPM *img;    
     Shader *shd;      
-    clock_t start, end;
-    double cpu_time_used;
+    std::chrono::steady_clock::time_point start, end;
+    double cpu_time_used;   // wall clock time (clock() would add up the time of all render threads)
     
     const int W = 640;
     const int H = 640;
@@ -48,9 +52,22 @@ int main(int argc, const char * argv[]) {
     scene.printSummary();
     //MassiveSphereScene(scene, 10000);
 
-    //  === BVH PARA RAYS, MATERIALS, ... E BVH EXLCUSIVO DE LUZES  ===
-    scene.BuildBVH(); // documentar para não funcionar
-    scene.BuildLightBVH(); // documentar para não funcionar
+    //  === BVH PARA RAYS, MATERIALS, ... E LUZES  ===
+    // BVHLayout::Binary, BVHLayout::Wide4 (SSE) ou BVHLayout::Wide8 (AVX, ver SIMDFLAGS na Makefile)
+    // true: as area lights entram no mesmo BVH (sem BVH exclusivo de luzes)
+    scene.BuildBVH(BVHLayout::Wide4, true); // documentar para não funcionar
+    //scene.BuildLightBVH(); // BVH exclusivo de luzes, com BuildBVH(layout, false)
+    // distribuição das luzes pela potência (DIRECT_SAMPLE_MODE UNIFORM_ONE)
+    scene.BuildLightDistribution();
+    // árvore de luzes, escolha pela contribuição estimada em cada ponto (DIRECT_SAMPLE_MODE LIGHT_TREE, também no PathTracing)
+    //scene.BuildLightTree();
+    // reservoirs por pixel para reutilizar amostras de luz entre amostras/frames e pixeis vizinhos (DIRECT_SAMPLE_MODE RESERVOIR)
+    //scene.BuildReservoirBuffer(W, H, true, true);
+    // cache de visibilidade das luzes por célula (DIRECT_SAMPLE_MODE VISIBILITY, roleta russa nos shadow rays em ALL_LIGHTS)
+    // a cache aprende durante o render: com ela a imagem deixa de ser reprodutível (ver seed abaixo)
+    //scene.BuildVisibilityCache();
+    // mapa de fotões para a iluminação indireta difusa do PathTracing (em vez de traçar o ressalto difuso)
+    //scene.BuildPhotonMap();
 
     //  === Default View Point  ===
     const Point Eye = {280, 265, -500}, At = {280, 260, 0};  
@@ -106,174 +123,71 @@ int main(int argc, const char * argv[]) {
     //shd = new WhittedShader(&scene, RGB(0.1,0.1,0.8));
     //shd = new DistributedShader(&scene, RGB(0.1,0.1,0.8));
     shd = new PathTracing(&scene, RGB(0., 0., 0.2));
+    // escolha das luzes como no DIRECT_SAMPLE_MODE do directLighting (UNIFORM_ONE por omissão);
+    // MIS só com UNIFORM_ONE e LIGHT_TREE, os outros modos traçam os seus shadow rays sem MIS
+    //shd = new PathTracing(&scene, RGB(0., 0., 0.2), true, LIGHT_TREE);
 
     int const spp = 16;
     bool const jitter = true;
 
-    StandardRenderer myRender(cam, &scene, img, shd, spp, jitter);
+    unsigned int const seed = 0;  // same seed => same image, whatever the renderer / number of threads
+    // (except with the visibility cache: VISIBILITY and ALL_LIGHTS then depend on the order
+    // in which the threads update it, see BuildVisibilityCache)
+
+    // amostras de baixa discrepância (Sobol' com scrambling de Owen) ; IndependentSampler = aleatórias
+    SobolSampler sampler(spp, seed);
+    //IndependentSampler sampler(seed);
+
+    //StandardRenderer myRender(cam, &scene, img, shd, spp, jitter, seed, &sampler);
+    ParallelRenderer myRender(cam, &scene, img, shd, spp, jitter, 0, 16, seed, &sampler);  // 0 threads = all cores, 16x16 tiles
+    // wavefront path tracing (PathTracing shader only): the paths of each 32x32 tile advance together, stage by stage
+    //WavefrontRenderer myRender(cam, &scene, img, (PathTracing *)shd, spp, jitter, 0, 32, seed, &sampler);
+    // amostragem adaptativa: 8 amostras por pixel, depois mais só onde o erro relativo estimado
+    // excede 2%, até 1024 spp ou 60 s (o sampler deve ser criado para 1024 spp)
+    //AdaptiveRenderer myRender(cam, &scene, img, shd, 8, 1024, 0.02f, 60., jitter, 0, 16, seed, &sampler);
+    // progressivo: passagens de 4 spp acumuladas até 1024 spp ou 600 s, com checkpoint a cada 30 s;
+    // se o processo for interrompido, voltar a correr retoma a partir do checkpoint
+    // (só se seed, spp, sampler, cena e câmara forem os mesmos; senão recusa-se a continuar)
+    //ProgressiveRenderer myRender(cam, &scene, img, shd, 4, 1024, 600., "render.ckpt", 30., jitter, 0, 16, seed, &sampler);
     
-    start = clock();
+    start = std::chrono::steady_clock::now();
     
     myRender.Render();  
 
-    end = clock();
-    cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
+    end = std::chrono::steady_clock::now();
+    cpu_time_used = std::chrono::duration<double>(end - start).count();
+
+    mkdir("result", 0777);
+    // imagem HDR (radiância, antes do tone mapping), para fazer o tone mapping offline sem voltar a renderizar
+    ImagePFM(*img).Save("result/reference.pfm");
+    //ImageHDR(*img).Save("result/reference.hdr");   // RGBE: 4 bytes por pixel
 
     // ============================================
-    // TONE MAPPING (Aplicar aos dados da imagem)
+    // PÓS-PROCESSAMENTO (filtros e tone mapping)
     // ============================================
     
-    // Choose tone mapping algorithm, If none defined, uses default ImagePPM tone mapping
-    //#define USE_REINHARD_BASIC_TONEMAP
-    //#define USE_REINHARD_ADVANCED_TONEMAP  
-    //#define USE_ACES_TONEMAP
-    //#define USE_EXPOSURE_TONEMAP
-    //#define USE_LINEAR_TONEMAP
-
-    RGB max_rgb(0, 0, 0), min_rgb(999, 999, 999);
-    for (int y = 0; y < H; y++) {
-        for (int x = 0; x < W; x++) {
-            RGB pixel = img->get(x, y);
-            max_rgb.R = std::max(max_rgb.R, pixel.R);
-            max_rgb.G = std::max(max_rgb.G, pixel.G);
-            max_rgb.B = std::max(max_rgb.B, pixel.B);
-            min_rgb.R = std::min(min_rgb.R, pixel.R);
-            min_rgb.G = std::min(min_rgb.G, pixel.G);
-            min_rgb.B = std::min(min_rgb.B, pixel.B);
+    // cada argumento da linha de comando é um pipeline, aplicado à mesma imagem HDR,
+    // p.ex. VI-RT "aces:1.5:2.2" "median,reinhard-advanced:1:2.2" "linear:1:2.2"
+    // produz result/reference_1.ppm, result/reference_2.ppm, ...
+    // sem argumentos: só clamp para [0,1] (result/reference.ppm)
+    // estágios: box, median, aces, exposure, linear, reinhard, reinhard-advanced (ver PostProcess.hpp)
+    std::vector<std::string> variants;
+    for (int i = 1; i < argc; i++) variants.push_back(argv[i]);
+    if (variants.empty()) variants.push_back("linear:1:1");
+
+    PostProcess post;   // os buffers são reutilizados de uma variante para a seguinte
+    for (size_t v = 0; v < variants.size(); v++) {
+        post.Clear();
+        if (!post.Parse(variants[v])) continue;
+        std::string const filename = (argc > 1) ? "result/reference_" + std::to_string(v + 1) + ".ppm" : "result/reference.ppm";
+        RGB max_rgb, min_rgb;
+        img->Save(filename, post, &min_rgb, &max_rgb);
+        if (v == 0) {
+            fprintf(stdout, "HDR Range - Min: (%.3f, %.3f, %.3f) Max: (%.3f, %.3f, %.3f)\n", 
+                    min_rgb.R, min_rgb.G, min_rgb.B, max_rgb.R, max_rgb.G, max_rgb.B);
         }
+        fprintf(stdout, "%s : %s\n", filename.c_str(), post.Describe().c_str());
     }
-    fprintf(stdout, "HDR Range - Min: (%.3f, %.3f, %.3f) Max: (%.3f, %.3f, %.3f)\n", 
-            min_rgb.R, min_rgb.G, min_rgb.B, max_rgb.R, max_rgb.G, max_rgb.B);
-    
-    #ifdef USE_ACES_TONEMAP
-        fprintf(stdout, "=== APPLYING ACES TONE MAPPING ===\n");
-        
-        RGB *hdr_data = new RGB[W * H];
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                hdr_data[y * W + x] = img->get(x, y);
-            }
-        }
-
-        RGB *ldr_data = new RGB[W * H];
-        ACES toneMapper(1.5f, 2.2f); 
-        toneMapper.ToneMap(W, H, hdr_data, ldr_data);
-
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                img->set(x, y, ldr_data[y * W + x]);
-            }
-        }
-
-        fprintf(stdout, "Applied ACES tone mapping (exposure=2.5)\n");
-        delete[] hdr_data;
-        delete[] ldr_data;
-
-    #elif defined(USE_REINHARD_BASIC_TONEMAP)
-        fprintf(stdout, "=== APPLYING REINHARD BASIC TONE MAPPING ===\n");
-        
-        RGB *hdr_data = new RGB[W * H];
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                hdr_data[y * W + x] = img->get(x, y);
-            }
-        }
-
-        RGB *ldr_data = new RGB[W * H];
-        ReinhardBasic toneMapper;
-        toneMapper.ToneMap(W, H, hdr_data, ldr_data);
-
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                img->set(x, y, ldr_data[y * W + x]);
-            }
-        }
-
-        fprintf(stdout, "Applied REINHARD BASIC tone mapping\n");
-        delete[] hdr_data;
-        delete[] ldr_data;
-        
-    #elif defined(USE_REINHARD_ADVANCED_TONEMAP)
-        #include "ToneMapper/ReinhardAdvanced.hpp"
-        
-        RGB *hdr_data = new RGB[W * H];
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                hdr_data[y * W + x] = img->get(x, y);
-            }
-        }
-        
-        RGB *ldr_data = new RGB[W * H];
-        ReinhardAdvanced toneMapper(1.0f, 2.2f);
-        toneMapper.ToneMap(W, H, hdr_data, ldr_data);
-        
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                img->set(x, y, ldr_data[y * W + x]);
-            }
-        }
-        
-        fprintf(stdout, "Applied REINHARD ADVANCED tone mapping\n");
-        
-        delete[] hdr_data;
-        delete[] ldr_data;
-        
-    #elif defined(USE_EXPOSURE_TONEMAP)
-        fprintf(stdout, "=== APPLYING EXPOSURE TONE MAPPING ===\n");
-        
-        RGB *hdr_data = new RGB[W * H];
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                hdr_data[y * W + x] = img->get(x, y);
-            }
-        }
-
-        RGB *ldr_data = new RGB[W * H];
-        Exposure toneMapper(1.0f, 2.2f); 
-        toneMapper.ToneMap(W, H, hdr_data, ldr_data);
-
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                img->set(x, y, ldr_data[y * W + x]);
-            }
-        }
-
-        fprintf(stdout, "Applied EXPOSURE tone mapping (exposure=0.3)\n");
-        delete[] hdr_data;
-        delete[] ldr_data;
-        
-    #elif defined(USE_LINEAR_TONEMAP)
-        #include "ToneMapper/Linear.hpp"
-        
-        RGB *hdr_data = new RGB[W * H];
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                hdr_data[y * W + x] = img->get(x, y);
-            }
-        }
-        
-        RGB *ldr_data = new RGB[W * H];
-        Linear toneMapper(1.0f, 2.2f);
-        toneMapper.ToneMap(W, H, hdr_data, ldr_data);
-        
-        for (int y = 0; y < H; y++) {
-            for (int x = 0; x < W; x++) {
-                img->set(x, y, ldr_data[y * W + x]);
-            }
-        }
-        
-        fprintf(stdout, "Applied LINEAR tone mapping\n");
-        
-        delete[] hdr_data;
-        delete[] ldr_data;
-        
-    #else
-        fprintf(stdout, "=== USING DEFAULT TONE MAPPING ===\n");
-        fprintf(stdout, "Using default ImagePPM tone mapping (Reinhard)\n");
-    #endif
-
-    mkdir("result", 0777);
-    img->Save("result/reference.ppm");
     
     fprintf(stdout, "Rendering time = %.3lf secs\n\n", cpu_time_used);
     
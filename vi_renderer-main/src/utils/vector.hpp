@@ -92,7 +92,7 @@ public:
     }
     // Generate an orthonormal coordinate system around this vector (must be normalized)
     // returns the 2 new axis orthogonal top the vector
-    void CoordinateSystem(Vector *v2, Vector *v3) {
+    void CoordinateSystem(Vector *v2, Vector *v3) const {
         if (abs(X) > abs(Y))
             *v2 = Vector(-Z, 0, X) / sqrtf(X * X + Z * Z);
         else
@@ -102,7 +102,7 @@ public:
 
     // returns a new vector, which is this vector rotated to the
     // reference system defined by Rx, Ry, Rz
-    Vector Rotate (Vector Rx, Vector Ry, Vector Rz) {
+    Vector Rotate (Vector Rx, Vector Ry, Vector Rz) const {
         Vector vec;
         
         vec.X = X * Rx.X + Y * Ry.X + Z * Rz.X;
@@ -111,6 +111,12 @@ public:
         return vec;
     }
 
+    // the inverse of Rotate: this vector's coordinates in the
+    // (orthonormal) reference system defined by Rx, Ry, Rz
+    Vector ToLocal (Vector Rx, Vector Ry, Vector Rz) const {
+        return Vector(dot(Rx), dot(Ry), dot(Rz));
+    }
+
 };
 
 class Point {
@@ -136,7 +142,7 @@ public:
         X=x;Y=y;Z=z;
     }
     // note that methods declared within the class are inline by default
-    inline Vector vec2point (Point p2) {
+    inline Vector vec2point (Point p2) const {
         Vector v(p2.X-X, p2.Y-Y, p2.Z-Z);
         return v;
     }